@@ -107,10 +107,11 @@ def init_encode_process(rs):
     log.info("codec: %s", encoder_obj)
 
 
-def encode_buffer(buffer):
+def encode_buffer(buffer, ecc):
     global encoder_obj
     log.debug("encode buffer %s", buffer)
-    return encoder_obj.encode(buffer.buf)
+    # write into shared memory instead of returning the ecc through the pool
+    encoder_obj.encode_into(buffer.buf, ecc.buf)
 
 
 def main(args):
@@ -126,6 +127,7 @@ def main(args):
     ):
         buf1 = shm.SharedMemory(rs.message_size)
         buf2 = shm.SharedMemory(rs.message_size)
+        ecc_bufs = {buf1.name: shm.SharedMemory(rs.ecc_size), buf2.name: shm.SharedMemory(rs.ecc_size)}
 
         prev_futures = None
 
@@ -133,18 +135,21 @@ def main(args):
 
         input_files = fs.input_files_iter(args.input_path.get(), args.exclude_rules.get(), args.output.get())
         for filelist, buffer in fs.fill_buffer_gen(input_files, rs.message_size, (buf1, buf2)):
-            encode_future = encode_process.submit(encode_buffer, buffer)
+            ecc = ecc_bufs[buffer.name]
+            encode_future = encode_process.submit(encode_buffer, buffer, ecc)
             hash_future = hash_process.submit(hash_buffer, buffer, filelist)
 
             if prev_futures:
-                prev_hash_future, prev_encode_future, prev_buf = prev_futures
-                output.write_block(prev_hash_future.result(), prev_encode_future.result())
+                prev_hash_future, prev_encode_future, prev_ecc = prev_futures
+                prev_encode_future.result()
+                output.write_block(prev_hash_future.result(), prev_ecc.buf[: rs.ecc_size])
 
-            prev_futures = (hash_future, encode_future, buffer)
+            prev_futures = (hash_future, encode_future, ecc)
 
         if prev_futures:
-            prev_hash_future, prev_encode_future, prev_buf = prev_futures
-            output.write_block(prev_hash_future.result(), prev_encode_future.result())
+            prev_hash_future, prev_encode_future, prev_ecc = prev_futures
+            prev_encode_future.result()
+            output.write_block(prev_hash_future.result(), prev_ecc.buf[: rs.ecc_size])
 
     log.info("done")
     return 0
@@ -10,6 +10,7 @@ import libffrs
 FFRS - Fairly Fast & Flexible Reed-Solomon coding
 """
 
+check_bounds: bool
 compiler_info: str
 class CIRC16:
     """Cross-interleaved Reed-Solomon coding over :math:`GF(65537)`"""
@@ -75,7 +76,7 @@ class CIRC16:
     """Outer Reed-Solomon codec (:class:`RSi16`)"""
 
     simd_x16: bool
-    """SIMD x16 encoding enabled (AVX512)"""
+    """SIMD x16 encoding enabled (AVX-512F, or two AVX2 vectors)"""
 
     simd_x4: bool
     """SIMD x4 encoding enabled (SSE2)"""
@@ -83,19 +84,25 @@ class CIRC16:
     simd_x8: bool
     """SIMD x8 encoding enabled (AVX2)"""
 
-    def __init__(self: libffrs.CIRC16, inner_block_len: typing.SupportsInt | typing.SupportsIndex, inner_ecc_len: typing.SupportsInt | typing.SupportsIndex, outer_block_len: typing.SupportsInt | typing.SupportsIndex, outer_ecc_len: typing.SupportsInt | typing.SupportsIndex, interleave: typing.SupportsInt | typing.SupportsIndex = 1, *, primitive: typing.SupportsInt | typing.SupportsIndex = 3, simd_x4: bool | None = None, simd_x8: bool | None = None, simd_x16: bool | None = None) -> None:
+    threads: int
+    """Default number of encoder threads"""
+
+    def __init__(self: libffrs.CIRC16, inner_block_len: typing.SupportsInt | typing.SupportsIndex, inner_ecc_len: typing.SupportsInt | typing.SupportsIndex, outer_block_len: typing.SupportsInt | typing.SupportsIndex, outer_ecc_len: typing.SupportsInt | typing.SupportsIndex, interleave: typing.SupportsInt | typing.SupportsIndex = 1, *, primitive: typing.SupportsInt | typing.SupportsIndex = 3, simd_x4: bool | None = None, simd_x8: bool | None = None, simd_x16: bool | None = None, threads: typing.SupportsInt | typing.SupportsIndex = 1) -> None:
         """Cross-interleaved Reed-Solomon coder"""
 
     def _find_outer_error_locations(self: libffrs.CIRC16, message: collections.abc.Buffer, ecc: collections.abc.Buffer, interleave: typing.SupportsInt | typing.SupportsIndex) -> list[int]:
         """Find outer codec error locations for a given interleaved block"""
 
-    def encode(self: libffrs.CIRC16, buffer: collections.abc.Buffer) -> bytearray:
-        """Encode data"""
+    def encode(self: libffrs.CIRC16, buffer: collections.abc.Buffer, *, reuse_output: bool = False, workspace: libffrs.Workspace | None = None) -> bytearray | memoryview:
+        """Encode data. With reuse_output, return a memoryview into a codec-owned buffer, overwritten by the next such call from the same thread"""
+
+    def encode_into(self: libffrs.CIRC16, buffer: collections.abc.Buffer, ecc_out: collections.abc.Buffer, *, workspace: libffrs.Workspace | None = None) -> int:
+        """Encode data into the writable buffer ecc_out, which must not overlap buffer. Return the number of bytes written"""
 
     def message_offset(self: libffrs.CIRC16, interleave: typing.SupportsInt | typing.SupportsIndex, row: typing.SupportsInt | typing.SupportsIndex, col: typing.SupportsInt | typing.SupportsIndex) -> int:
         """Calculate message offset in number of elements"""
 
-    def repair(self: libffrs.CIRC16, message: collections.abc.Buffer, ecc: collections.abc.Buffer) -> bool:
+    def repair(self: libffrs.CIRC16, message: collections.abc.Buffer, ecc: collections.abc.Buffer, *, workspace: libffrs.Workspace | None = None) -> bool:
         """Repair data"""
 
     def rsi_ecc_offset(self: libffrs.CIRC16, interleave: typing.SupportsInt | typing.SupportsIndex, row: typing.SupportsInt | typing.SupportsIndex, col: typing.SupportsInt | typing.SupportsIndex) -> int:
@@ -246,6 +253,7 @@ class GFi16:
 
 class NTT:
     block_len: int
+    cache_budget: int
     ecc_len: int
     ecc_size: int
     ntt16_size: int
@@ -368,8 +376,11 @@ class RS256:
     def _synds(self: libffrs.RS256, buffer: collections.abc.Buffer) -> bytearray:
         """Compute syndromes"""
 
-    def encode(self: libffrs.RS256, buffer: collections.abc.Buffer) -> bytearray:
-        """Encode message, return ecc"""
+    def encode(self: libffrs.RS256, buffer: collections.abc.Buffer, *, reuse_output: bool = False) -> bytearray | memoryview:
+        """Encode message, return ecc. With reuse_output, return a memoryview into a codec-owned buffer, overwritten by the next such call from the same thread"""
+
+    def encode_into(self: libffrs.RS256, buffer: collections.abc.Buffer, ecc_out: collections.abc.Buffer) -> int:
+        """Encode message into the writable buffer ecc_out, which must not overlap buffer. Return the number of bytes written"""
 
     def repair(self: libffrs.RS256, buffer: collections.abc.Buffer, ecc: collections.abc.Buffer) -> bool:
         """Repair message + ecc"""
@@ -379,6 +390,9 @@ class RS256:
 class RSi16:
     """Reed-Solomon coding over :math:`GF(65537)`"""
 
+    _plan_id: int
+    """Sequence number of the shared tables of the codec, equal for codecs sharing them"""
+
     block_len: int
     """Interleaved block length in number of elements"""
 
@@ -433,8 +447,14 @@ class RSi16:
     rs_message_size: int
     """Reed-Solomon message size in bytes"""
 
+    simd_epi16: int
+    """Lanes of the 16-bit lane interleaved encoder (AVX2: 16, AVX-512BW: 32), 0 if disabled"""
+
     simd_x16: bool
-    """SIMD x16 encoding enabled (AVX512)"""
+    """SIMD x16 encoding enabled (AVX-512F, or two AVX2 vectors)"""
+
+    simd_x16_avx2: bool
+    """SIMD x16 runs as two AVX2 vectors instead of AVX-512F"""
 
     simd_x4: bool
     """SIMD x4 encoding enabled (SSE2)"""
@@ -442,8 +462,14 @@ class RSi16:
     simd_x8: bool
     """SIMD x8 encoding enabled (AVX2)"""
 
-    def __init__(self: libffrs.RSi16, block_len: typing.SupportsInt | typing.SupportsIndex, ecc_len: typing.SupportsInt | typing.SupportsIndex, interleave: typing.SupportsInt | typing.SupportsIndex = 1, *, primitive: typing.SupportsInt | typing.SupportsIndex = 3, simd_x4: bool | None = None, simd_x8: bool | None = None, simd_x16: bool | None = None) -> None:
-        """Instantiate a Reed-Solomon encoder with the given configuration"""
+    threads: int
+    """Default number of encoder threads"""
+
+    def __init__(self: libffrs.RSi16, block_len: typing.SupportsInt | typing.SupportsIndex, ecc_len: typing.SupportsInt | typing.SupportsIndex, interleave: typing.SupportsInt | typing.SupportsIndex = 1, *, primitive: typing.SupportsInt | typing.SupportsIndex = 3, simd_x4: bool | None = None, simd_x8: bool | None = None, simd_x16: bool | None = None, threads: typing.SupportsInt | typing.SupportsIndex = 1, simd_epi16: bool = False) -> None:
+        """Instantiate a Reed-Solomon encoder with the given configuration. simd_epi16: interleaved encode in 16-bit lanes, faster than 32-bit lanes only with AVX-512BW and small ecc_len"""
+
+    def _repair_ntt(self: libffrs.RSi16, message: collections.abc.Buffer, ecc: collections.abc.Buffer, error_pos: collections.abc.Sequence[typing.SupportsInt | typing.SupportsIndex]) -> None:
+        """Repair a block with the given error locations through the full NTT, or evaluating at the error locations for large error counts"""
 
     def _roots(self: libffrs.RSi16, synd: collections.abc.Sequence[typing.SupportsInt | typing.SupportsIndex]) -> list[int]:
         """Find locator polynomial roots"""
@@ -466,13 +492,16 @@ class RSi16:
     def ecc_offset(self: libffrs.RSi16, row: typing.SupportsInt | typing.SupportsIndex, col: typing.SupportsInt | typing.SupportsIndex) -> int:
         """Calculate ECC offset in number of elements"""
 
-    def encode(self: libffrs.RSi16, buffer: collections.abc.Buffer) -> bytearray:
-        """Systematic encode"""
+    def encode(self: libffrs.RSi16, buffer: collections.abc.Buffer, *, threads: typing.SupportsInt | typing.SupportsIndex | None = None, reuse_output: bool = False, workspace: libffrs.Workspace | None = None) -> bytearray | memoryview:
+        """Systematic encode. threads: overrides the codec default, 0 for one per hardware thread. With reuse_output, return a memoryview into a codec-owned buffer, overwritten by the next such call from the same thread"""
+
+    def encode_into(self: libffrs.RSi16, buffer: collections.abc.Buffer, ecc_out: collections.abc.Buffer, *, threads: typing.SupportsInt | typing.SupportsIndex | None = None, workspace: libffrs.Workspace | None = None) -> int:
+        """Systematic encode into the writable buffer ecc_out, which must not overlap buffer. Return the number of bytes written"""
 
     def message_offset(self: libffrs.RSi16, row: typing.SupportsInt | typing.SupportsIndex, col: typing.SupportsInt | typing.SupportsIndex) -> int:
         """Calculate message offset in number of elements"""
 
-    def repair(self: libffrs.RSi16, message: collections.abc.Buffer, ecc: collections.abc.Buffer, error_pos: collections.abc.Sequence[typing.SupportsInt | typing.SupportsIndex] | None = None) -> libffrs.RepairStatus:
+    def repair(self: libffrs.RSi16, message: collections.abc.Buffer, ecc: collections.abc.Buffer, error_pos: collections.abc.Sequence[typing.SupportsInt | typing.SupportsIndex] | None = None, unknown_errors: bool = False, *, workspace: libffrs.Workspace | None = None) -> libffrs.RepairStatus:
         """Repair a block with the given error locations"""
 
 
@@ -507,6 +536,19 @@ class RepairStatus:
         ...
 
 
+class Workspace:
+    """
+    Scratch memory for ``encode`` and ``repair``, reused across calls instead of being
+            allocated by each one. It grows to the largest call using it and serves one call
+            at a time. Without one, each thread uses its own.
+    """
+
+    size: int
+    """Bytes reserved"""
+
+    def __init__(self: libffrs.Workspace, size: typing.SupportsInt | typing.SupportsIndex = 0) -> None:
+        """Reserve ``size`` bytes up front"""
+
 def create_buffer(size: typing.SupportsInt | typing.SupportsIndex) -> memoryview:
     """
     Create a memory buffer of the specified size, backed by hugepages if possible.
@@ -514,6 +556,20 @@ def create_buffer(size: typing.SupportsInt | typing.SupportsIndex) -> memoryview
             The buffer is returned as a memoryview object that can be used in Python.
     """
 
+def get_simd_isa() -> str:
+    """Widest instruction set enabled by default for new codecs."""
+
 def set_logger(logger: object) -> None:
     """Logger object to be used by C++ library or ``None`` to disable logging."""
 
+def set_simd_isa(name: str | None) -> None:
+    """
+    Limit the instruction set enabled by default for new codecs to ``name`` and narrower ones,
+            or ``None`` to use the widest one supported by the CPU. Existing codecs are not affected
+            and ``simd_x*`` arguments take precedence. ``avx2x2`` (16 lanes as two AVX2 vectors) is
+            only enabled by default when selected here.
+    """
+
+def simd_isa() -> list[tuple[str, int, bool]]:
+    """Instruction sets compiled into the library as ``(name, width, supported)``, widest first."""
+
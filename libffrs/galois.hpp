@@ -25,6 +25,10 @@
 #include <cstring>
 #include <functional>
 
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+
 #include "detail.hpp"
 
 namespace ffrs {
@@ -255,6 +259,26 @@ public:
  ***********/
 
 
+/*
+ * Residues (lazy reduction)
+ *
+ * A residue is a 32-bit value read as a signed integer, standing for that
+ * integer mod p. `*_residue` operations skip the final reduction, so the
+ * magnitude of a residue grows with every operation; the caller tracks an
+ * upper bound B on |x| and reduces with `mod_p` before B would reach 2^31.
+ *
+ *   add_residue, sub_residue       |a| < A, |b| < B    ->  |x| < A + B
+ *   mod_p                          any int32           ->  [0, p)
+ *   mul_shoup_residue              [0, 2^32)           ->  [0, 2p)
+ *
+ * A residue |x| < B is made a mul_shoup_residue operand by adding a multiple
+ * of p not below B (NTT::residue_bias) instead of reducing it.
+ *
+ * See NTT::ct_pass_bound and NTT::gs_pass_bound for the per-pass bounds of
+ * the butterflies.
+ */
+
+
 template<typename GFT, typename GF>
 class gf_add_i16_shift {
 public:
@@ -374,6 +398,9 @@ public:
         }
     }
 
+    /**
+     * canonical representative in [0, p) of the residue `res` (any int32)
+     */
     template<typename T>
     inline T mod_p(T res) const {
         if constexpr (std::is_integral_v<T>) {
@@ -385,10 +412,118 @@ public:
             // res = (res & 0xffff) - (res >> 16) - (res >> 31);
             // res += (res >= 0x80000000) & 0x10001;
 
+            // lo - hi - sign is negative exactly when hi + sign > lo
+            T lo = res & 0xffff;
+            T hi = (res >> 16) + (res >> 31);
+            res = lo - hi + ((hi > lo) & 0x10001);
+
+            return res;
+        }
+    }
+
+    /**
+     * lhs * 2^shift
+     * lhs: any unsigned value below 2^(32 - shift)
+     * 256 and -256 are the 4th roots of unity, so this is the radix-4 twiddle
+     */
+    template<typename T>
+    inline T mul_pow2(T const& lhs, unsigned shift) const {
+        T res = lhs << shift;
+        if constexpr (std::is_integral_v<T>) {
+            res = (res & 0xffff) - (res >> 16);
+            if (res >= 0x80000000)
+                res += 0x10001;
+            return res;
+        } else {
             T lo = res & 0xffff;
             T hi = res >> 16;
-            res = lo - hi - (res >> 31) + ((hi >= lo) & 0x10001);
+            return lo - hi + ((hi > lo) & 0x10001);
+        }
+    }
+
+    /**
+     * Shoup quotient for multiplication by the constant `w`
+     * floor(w * 2^32 / p), which is w * (2^16 - 1) for w in [0, p) since 2^32 = p * (2^16 - 1) + 1
+     */
+    template<typename T>
+    inline T mul_shoup_q(T const& w) const {
+        return w * 0xffff;
+    }
+
+    /**
+     * lhs * w, where wq = mul_shoup_q(w)
+     * lhs: any unsigned 32-bit value (not a negative residue)
+     * result in [0, 2p)
+     */
+    template<typename T>
+    inline T mul_shoup_residue(T const& lhs, GFT const& w, GFT const& wq) const {
+        T q = mulhi(lhs, wq);
+        return lhs * w - q * 0x10001;
+    }
 
+    /**
+     * lhs * w, where wq = mul_shoup_q(w)
+     * lhs: any unsigned 32-bit value (not a negative residue)
+     */
+    template<typename T>
+    inline T mul_shoup(T const& lhs, GFT const& w, GFT const& wq) const {
+        T res = mul_shoup_residue(lhs, w, wq);
+        if constexpr (std::is_integral_v<T>) {
+            if (res >= 0x10001)
+                res -= 0x10001;
+            return res;
+        } else {
+            // unsigned min(res, res - p)
+            T alt = res - 0x10001;
+            if constexpr (requires { res.lo; })
+                return T{res.lo < alt.lo ? res.lo : alt.lo, res.hi < alt.hi ? res.hi : alt.hi};
+            else
+                return res < alt ? res : alt;
+        }
+    }
+
+private:
+    /**
+     * high 32 bits of lhs * rhs
+     */
+    template<typename T>
+    static inline T mulhi(T const& lhs, GFT const& rhs) {
+        if constexpr (std::is_integral_v<T>) {
+            return T((uint64_t(lhs) * rhs) >> 32);
+        }
+        else if constexpr (requires { lhs.lo; }) {
+            // vec::x2, one half at a time
+            return T{mulhi(lhs.lo, rhs), mulhi(lhs.hi, rhs)};
+        }
+#ifdef __AVX512F__
+        else if constexpr (sizeof(T) == 64) {
+            __m512i r = _mm512_set1_epi32(rhs);
+            __m512i even = _mm512_srli_epi64(_mm512_mul_epu32(__m512i(lhs), r), 32);
+            __m512i odd = _mm512_mul_epu32(_mm512_srli_epi64(__m512i(lhs), 32), r);
+            return T(_mm512_mask_blend_epi32(0xaaaa, even, odd));
+        }
+#endif
+#ifdef __AVX2__
+        else if constexpr (sizeof(T) == 32) {
+            __m256i r = _mm256_set1_epi32(rhs);
+            __m256i even = _mm256_srli_epi64(_mm256_mul_epu32(__m256i(lhs), r), 32);
+            __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(__m256i(lhs), 32), r);
+            return T(_mm256_blend_epi32(even, odd, 0xaa));
+        }
+#endif
+#ifdef __SSE2__
+        else if constexpr (sizeof(T) == 16) {
+            __m128i r = _mm_set1_epi32(rhs);
+            __m128i even = _mm_srli_epi64(_mm_mul_epu32(__m128i(lhs), r), 32);
+            __m128i odd = _mm_mul_epu32(_mm_srli_epi64(__m128i(lhs), 32), r);
+            odd = _mm_and_si128(odd, _mm_set1_epi64x(0xffffffff00000000));
+            return T(_mm_or_si128(even, odd));
+        }
+#endif
+        else {
+            T res;
+            for (size_t i = 0; i < sizeof(T) / sizeof(GFT); ++i)
+                res[i] = GFT((uint64_t(lhs[i]) * rhs) >> 32);
             return res;
         }
     }
@@ -20,7 +20,10 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <stdexcept>
+#include <string>
+#include <utility>
 #include <vector>
 #include <cstdlib>
 
@@ -29,6 +32,77 @@
 #include "simd.hpp"
 
 
+/**
+ * Twiddles of the radix-4 passes, packed by pass.
+ * The pass with stride s uses w^(j * n / (4 * s)) for j in [0, s) (the same in CT and GS):
+ * it stores {w^j', q(w^j'), w^2j', q(w^2j'), w^3j', q(w^3j')} for each j contiguously,
+ * starting at 2 * (s - first_stride). Every pass reads its twiddles sequentially.
+ */
+struct ntt_twiddles {
+    std::vector<::GFT> tw;
+    // stride of the first radix-4 pass (CT), 1 or 2
+    size_t first_stride = 1;
+    // the 4th root of unity is either 256 or -256
+    bool w4_neg = false;
+
+    static constexpr size_t first(size_t n) {
+        return (__builtin_ctzl(n) & 1) ? 2 : 1;
+    }
+
+    static constexpr size_t size(size_t n) {
+        return 2 * (n - first(n));
+    }
+
+    inline const ::GFT *pass(size_t stride) const {
+        return tw.data() + 2 * (stride - first_stride);
+    }
+};
+
+
+/**
+ * packed twiddles (see ntt_twiddles) of the root of unity of order N (or its inverse)
+ * for the default primitive, for the compile-time specialized ecc transforms
+ */
+template<size_t N, bool Inverse>
+struct ntt_fixed_roots {
+    static constexpr ::GFT primitive = 3;
+
+    static constexpr ::GFT pow(uint64_t a, uint64_t e) {
+        uint64_t res = 1;
+        for (; e; e >>= 1, a = a * a % 0x10001) {
+            if (e & 1)
+                res = res * a % 0x10001;
+        }
+        return ::GFT(res);
+    }
+
+    static constexpr ::GFT root = pow(primitive, Inverse ? 0x10000 - 0x10000 / N : 0x10000 / N);
+
+    static constexpr size_t first_stride = ntt_twiddles::first(N);
+
+    static constexpr bool w4_neg = N >= 4 && pow(root, N / 4) != 256;
+
+    static constexpr std::array<::GFT, ntt_twiddles::size(N)> tw = [] {
+        std::array<::GFT, ntt_twiddles::size(N)> tw = {};
+        size_t k = 0;
+        for (size_t s = first_stride; s < N; s *= 4) {
+            for (size_t j = 0; j < s; ++j) {
+                for (size_t m = 1; m <= 3; ++m) {
+                    ::GFT w = pow(root, m * j * (N / (4 * s)));
+                    tw[k++] = w;
+                    tw[k++] = ::GFT((uint64_t(w) << 32) / 0x10001);
+                }
+            }
+        }
+        return tw;
+    }();
+
+    static constexpr const ::GFT *pass(size_t stride) {
+        return tw.data() + 2 * (stride - first_stride);
+    }
+};
+
+
 struct NTT {
     ::GFT root;
     size_t ntt_len;
@@ -42,6 +116,9 @@ struct NTT {
     ::GFT ntt_len_i;
     ::GFT ecc_len_i;
     ::GFT ecc2_len_i;
+    ::GFT ntt_len_i_q;
+    ::GFT ecc_len_i_q;
+    ::GFT ecc2_len_i_q;
     std::vector<::GFT> _roots_ntt;
     std::vector<::GFT> _roots_i_ntt;
     std::vector<::GFT> _roots_ecc;
@@ -52,6 +129,29 @@ struct NTT {
     std::vector<::GFT> _pintt_shift;
     std::vector<::GFT> _rbo_ecc;
 
+    // Shoup quotients of the constant tables above, see gf_mul_i16_shift::mul_shoup
+    std::vector<::GFT> _roots_ecc_q;
+    std::vector<::GFT> _roots_i_ecc_q;
+    std::vector<::GFT> _pntt_shift_q;
+    std::vector<::GFT> _pintt_shift_q;
+
+    // butterfly twiddles of the root tables above
+    ntt_twiddles _tw_ntt;
+    ntt_twiddles _tw_i_ntt;
+    ntt_twiddles _tw_ecc;
+    ntt_twiddles _tw_i_ecc;
+    ntt_twiddles _tw_ecc2;
+    ntt_twiddles _tw_i_ecc2;
+
+    // transforms larger than this (in bytes) use the cache-blocked schedule,
+    // may be changed from Python while transforms run: read once per transform
+    static inline std::atomic<size_t> cache_budget{256 * 1024};
+
+    // ecc transforms up to this length are specialized at compile time
+    static constexpr size_t max_fixed_ecc_len = 256;
+    // log2(ecc_len) if the specialized ecc transforms apply, 0 otherwise
+    size_t _ecc_fixed_log;
+
     inline NTT(GFi16 const& gf, size_t block_len, size_t ecc_len):
         gf(gf),
         block_len(block_len),
@@ -70,13 +170,9 @@ struct NTT {
         py_assert(gf.pow(root, ntt_len) == 1, "ntt root of unity sanity check failed");
         py_assert(gf.pow(root, ntt_len / 2) == 65536, "ntt root of unity sanity check failed");
 
-        ::GFT root_i = gf.inv(root);
         _roots_ntt.resize(ntt_len);
-        _roots_i_ntt.resize(ntt_len);
-        for (size_t i = 0; i < ntt_len; ++i) {
-            _roots_ntt[i] = gf.pow(root, i);
-            _roots_i_ntt[i] = gf.pow(root_i, i);
-        }
+        powers(root, 1, &_roots_ntt[0], ntt_len);
+        _roots_i_ntt = _roots_inverse(_roots_ntt);
 
         _rbo_ecc.resize(ecc_len);
         for (size_t i = 0; i < ecc_len; ++i) {
@@ -88,38 +184,124 @@ struct NTT {
         ::GFT ecc_root = gf.pow(gf.primitive, 65536 / ecc_len);
         py_assert(gf.pow(ecc_root, ecc_len) == 1, "ntt root of unity sanity check failed");
         py_assert(gf.pow(ecc_root, ecc_len / 2) == 65536, "ntt root of unity sanity check failed");
-        ::GFT ecc_root_i = gf.inv(ecc_root);
-        _roots_ecc.resize(ecc_len);
-        _roots_i_ecc.resize(ecc_len);
-        for (size_t i = 0; i < ecc_len; ++i) {
-            _roots_ecc[i] = gf.pow(ecc_root, i);
-            _roots_i_ecc[i] = gf.pow(ecc_root_i, i);
-        }
+        _roots_ecc = _roots_sub(ecc_root, ecc_len);
+        _roots_i_ecc = _roots_inverse(_roots_ecc);
 
         ::GFT ecc2_root = gf.pow(gf.primitive, 65536 / (ecc_len * 2));
         py_assert(gf.pow(ecc2_root, ecc_len * 2) == 1, "ntt root of unity sanity check failed");
         py_assert(gf.pow(ecc2_root, ecc_len) == 65536, "ntt root of unity sanity check failed");
-        ::GFT ecc2_root_i = gf.inv(ecc2_root);
-        _roots_ecc2.resize(ecc_len * 2);
-        _roots_i_ecc2.resize(ecc_len * 2);
-        for (size_t i = 0; i < ecc_len * 2; ++i) {
-            _roots_ecc2[i] = gf.pow(ecc2_root, i);
-            _roots_i_ecc2[i] = gf.pow(ecc2_root_i, i);
-        }
+        _roots_ecc2 = _roots_sub(ecc2_root, ecc_len * 2);
+        _roots_i_ecc2 = _roots_inverse(_roots_ecc2);
 
+        // root^(j * rbo(blk)) and root^-(j * rbo(blk)) / ntt_len for j in [0, ecc_len)
         _pntt_shift.resize(block_len);
-        for (size_t i = 0; i < block_len; ++i) {
-            auto blk = (i / ecc_len) * ecc_len;
-            auto j = i - blk;
-            _pntt_shift[i] = gf.pow(root, j * rbo(blk));
-        }
+        for (size_t blk = 0; blk < block_len; blk += ecc_len)
+            powers(_roots_ntt[rbo(blk)], 1, &_pntt_shift[blk], std::min(ecc_len, block_len - blk));
 
         _pintt_shift.resize(ntt_len);
-        for (size_t i = 0; i < ntt_len; ++i) {
-            auto blk = (i / ecc_len) * ecc_len;
-            auto j = i - blk;
-            _pintt_shift[i] = gf.div(gf.pow(root_i, j * rbo(blk)), ntt_len);
+        for (size_t blk = 0; blk < ntt_len; blk += ecc_len)
+            powers(_roots_i_ntt[rbo(blk)], ntt_len_i, &_pintt_shift[blk], std::min(ecc_len, ntt_len - blk));
+
+        ntt_len_i_q = gf.mul_shoup_q(ntt_len_i);
+        ecc_len_i_q = gf.mul_shoup_q(ecc_len_i);
+        ecc2_len_i_q = gf.mul_shoup_q(ecc2_len_i);
+        _roots_ecc_q = shoup_q(_roots_ecc);
+        _roots_i_ecc_q = shoup_q(_roots_i_ecc);
+        _pntt_shift_q = shoup_q(_pntt_shift);
+        _pintt_shift_q = shoup_q(_pintt_shift);
+
+        _tw_ntt = twiddles(_roots_ntt);
+        _tw_i_ntt = twiddles(_roots_i_ntt);
+        _tw_ecc = twiddles(_roots_ecc);
+        _tw_i_ecc = twiddles(_roots_i_ecc);
+        _tw_ecc2 = twiddles(_roots_ecc2);
+        _tw_i_ecc2 = twiddles(_roots_i_ecc2);
+
+        _ecc_fixed_log = 0;
+        if (gf.primitive == ntt_fixed_roots<2, false>::primitive && ecc_len <= max_fixed_ecc_len)
+            _ecc_fixed_log = __builtin_ctzl(ecc_len);
+    }
+
+    std::vector<::GFT> shoup_q(std::vector<::GFT> const& table) const {
+        std::vector<::GFT> res(table.size());
+        for (size_t i = 0; i < table.size(); ++i)
+            res[i] = gf.mul_shoup_q(table[i]);
+        return res;
+    }
+
+    /**
+     * out[i] = scale * w^i for i in [0, n)
+     * running products over `lanes` interleaved chains, so that the loop vectorizes
+     */
+    inline void powers(::GFT w, ::GFT scale, ::GFT *const out, size_t n) const {
+        constexpr size_t lanes = 16;
+
+        const ::GFT wq = gf.mul_shoup_q(w);
+        ::GFT x = scale;
+        for (size_t i = 0; i < std::min(n, lanes); ++i) {
+            out[i] = x;
+            x = gf.mul_shoup(x, w, wq);
         }
+
+        // x = scale * w^lanes
+        const ::GFT wl = gf.div(x, scale);
+        const ::GFT wlq = gf.mul_shoup_q(wl);
+        for (size_t i = lanes; i < n; ++i)
+            out[i] = gf.mul_shoup(out[i - lanes], wl, wlq);
+    }
+
+    /**
+     * powers of `w`, a root of unity of order `n`, as a subsequence of `_roots_ntt` when n <= ntt_len
+     */
+    inline std::vector<::GFT> _roots_sub(::GFT w, size_t n) const {
+        std::vector<::GFT> res(n);
+        if (n > ntt_len) {
+            powers(w, 1, &res[0], n);
+            return res;
+        }
+
+        for (size_t i = 0; i < n; ++i)
+            res[i] = _roots_ntt[i * (ntt_len / n)];
+        return res;
+    }
+
+    /**
+     * powers of w^-1 from the powers of a root of unity w: w^-i = w^(n - i)
+     */
+    static inline std::vector<::GFT> _roots_inverse(std::vector<::GFT> const& roots) {
+        const size_t n = roots.size();
+        std::vector<::GFT> res(n);
+        res[0] = roots[0];
+        for (size_t i = 1; i < n; ++i)
+            res[i] = roots[n - i];
+        return res;
+    }
+
+    /**
+     * packs the twiddles of a table of powers of a root of unity of order roots.size()
+     */
+    ntt_twiddles twiddles(std::vector<::GFT> const& roots) const {
+        const size_t n = roots.size();
+        ntt_twiddles res;
+        res.first_stride = ntt_twiddles::first(n);
+        res.w4_neg = n >= 4 && roots[n / 4] != 256;
+        res.tw.resize(ntt_twiddles::size(n));
+        for (size_t s = res.first_stride; s < n; s *= 4) {
+            auto tw = &res.tw[2 * (s - res.first_stride)];
+            const size_t exp_f = n / (4 * s);
+            for (size_t j = 0; j < s; ++j) {
+                auto w1 = roots[j * exp_f];
+                auto w2 = roots[j * exp_f * 2];
+                auto w3 = roots[j * exp_f * 3];
+                tw[j * 6 + 0] = w1;
+                tw[j * 6 + 1] = gf.mul_shoup_q(w1);
+                tw[j * 6 + 2] = w2;
+                tw[j * 6 + 3] = gf.mul_shoup_q(w2);
+                tw[j * 6 + 4] = w3;
+                tw[j * 6 + 5] = gf.mul_shoup_q(w3);
+            }
+        }
+        return res;
     }
 
     uint16_t rbo(uint16_t b) const {
@@ -132,23 +314,23 @@ struct NTT {
      */
     template<typename GFT>
     inline void pntt(GFT *const block) const {
-        {
-            ct_butterfly(&_roots_ecc[0], &block[0], ecc_len);
-
-            for (size_t j = 0; j < ecc_len; ++j)
-                block[j] = gf.mul(block[j], _pntt_shift[j]);
-        }
+        _pntt_residue(&block[0], pntt_blocks);
 
-        for (size_t i = 1; i < pntt_blocks; ++i) {
-            auto p = &block[i * ecc_len];
-            ct_butterfly(&_roots_ecc[0], &p[0], ecc_len);
+        for (size_t j = 0; j < ecc_len; ++j)
+            block[j] = gf.mod_p(block[j]);
+    }
 
-            for (size_t j = 0; j < ecc_len; ++j)
-                p[j] = gf.mul(p[j], _pntt_shift[i * ecc_len + j]);
+    /**
+     * partial NTT, non-destructive
+     * computes the first `ecc_len` symbols of the NTT of `block` into `synds`
+     * temp: ecc_len
+     */
+    template<typename GFT>
+    inline void pntt(const GFT *const block, GFT *const synds, GFT *const temp) const {
+        (this->*_ecc_dispatch<GFT>().pntt_residue[_ecc_fixed_log])(block, pntt_blocks, synds, temp);
 
-            for (size_t j = 0; j < ecc_len; ++j)
-                block[j] = gf.add(block[j], block[i * ecc_len + j]);
-        }
+        for (size_t j = 0; j < ecc_len; ++j)
+            synds[j] = gf.mod_p(synds[j]);
     }
 
     /**
@@ -158,173 +340,789 @@ struct NTT {
      */
     template<typename GFT>
     inline void pntt_message(GFT *const block) const {
-        {
-            ct_butterfly(&_roots_ecc[0], &block[0], ecc_len);
+        _pntt_residue(&block[0], pntt_blocks - 1);
 
-            for (size_t j = 0; j < ecc_len; ++j)
-                block[j] = gf.mul(block[j], _pntt_shift[j]);
-        }
+        for (size_t j = 0; j < ecc_len; ++j)
+            block[j] = gf.mod_p(block[j]);
+    }
 
-        for (size_t i = 1; i < pntt_blocks - 1; ++i) {
-            auto p = &block[i * ecc_len];
-            ct_butterfly(&_roots_ecc[0], &p[0], ecc_len);
+    /**
+     * pntt_message with residue output
+     * returns the bound of the residues in `block[0, ecc_len)`
+     */
+    template<typename GFT>
+    inline uint64_t pntt_message_residue(GFT *const block) const {
+        return _pntt_residue(&block[0], pntt_blocks - 1);
+    }
 
-            for (size_t j = 0; j < ecc_len; ++j)
-                p[j] = gf.mul(p[j], _pntt_shift[i * ecc_len + j]);
+    /**
+     * pntt_message_residue with the message read by `load(i, buf)`, which returns
+     * sub-block i (ecc_len canonical symbols), written to `buf` if it is not in place.
+     * Only one sub-block is held at a time, so the message can stay in its own storage.
+     * ecc: ecc_len, temp: ecc_len
+     * returns the bound of the residues in `ecc[0, ecc_len)`
+     */
+    template<typename GFT, typename Load>
+    inline uint64_t pntt_message_residue(Load&& load, GFT *const ecc, GFT *const temp) const {
+        return _ecc_fixed([&]<size_t N>(std::integral_constant<size_t, N>) {
+            return _pntt_residue_load_n<N>(load, pntt_blocks - 1, ecc, temp);
+        });
+    }
 
-            for (size_t j = 0; j < ecc_len; ++j)
-                block[j] = gf.add(block[j], block[i * ecc_len + j]);
-        }
+    /**
+     * sum of the shifted NTTs of the first `blocks` sub-blocks, accumulated in `block[0, ecc_len)`
+     * input: canonical symbols
+     * returns the bound of the residues in `block[0, ecc_len)`
+     */
+    template<typename GFT>
+    inline uint64_t _pntt_residue(GFT *const block, size_t blocks) const {
+        return (this->*_ecc_dispatch<GFT>().pntt_residue[_ecc_fixed_log])(block, blocks, block, nullptr);
     }
 
+    /**
+     * partial iNTT
+     * computes the full iNTT from the first `ecc_len` symbols of `block`
+     * normal order input, RBO output
+     */
     template<typename GFT>
-    inline void pntt_message_residue(GFT *const block) const {
-        {
-            ct_butterfly_residue(&_roots_ecc[0], &block[0], ecc_len);
+    inline void pintt_ecc(GFT *const ntt_block) const {
+        (this->*_ecc_dispatch<GFT>().pintt_ecc[_ecc_fixed_log])(ntt_block);
+    }
+
+    /**
+     * Pruned partial iNTT for root search: evaluates the polynomial `poly` of length `len` <= ecc_len
+     * at the positions [0, end) of pintt_ecc, up to the 1/ntt_len factor (zeros are preserved).
+     * Only the first m = 2^ceil(log2 len) outputs of each length-ntt_len butterfly depend on
+     * the input, so the transform is done in sub-blocks of m instead of ecc_len symbols.
+     * `visit(offset, values, count)` receives each sub-block (canonical symbols) in order,
+     * the transform stops when it returns false.
+     * temp: m symbols
+     */
+    template<typename GFT, typename Visit>
+    inline void pintt_pruned(const GFT *const poly, size_t len, size_t end, GFT *const temp, Visit&& visit) const {
+        const size_t m = std::max<size_t>(2, size_t(1) << ffrs::detail::ilog2_ceil(std::max<size_t>(len, 1)));
+        py_assert(m <= ecc_len, "pintt_pruned: polynomial longer than ecc_len");
+
+        // the twiddles of a pass depend only on its stride, use the table with the same passes as m
+        auto const& tw = (__builtin_ctzl(m) & 1) == (__builtin_ctzl(ecc_len) & 1) ? _tw_i_ecc : _tw_i_ecc2;
+
+        for (size_t offset = 0; offset < end; offset += m) {
+            // poly[j] * w^-(j * rbo(offset))
+            const ::GFT w = _roots_i_ntt[rbo(offset)];
+            const ::GFT wq = gf.mul_shoup_q(w);
+            ::GFT x = 1;
+            temp[0] = poly[0];
+            for (size_t j = 1; j < len; ++j) {
+                x = gf.mul_shoup(x, w, wq);
+                temp[j] = gf.mul_shoup(poly[j], x, gf.mul_shoup_q(x));
+            }
+            std::fill(&temp[len], &temp[m], GFT{0});
 
-            for (size_t j = 0; j < ecc_len; ++j)
-                block[j] = gf.mul_residue(gf.mod_p(block[j]), _pntt_shift[j]);
+            gs_butterfly_residue(tw, &temp[0], m, m, 0x10001);
+            for (size_t j = 0; j < m; ++j)
+                temp[j] = gf.mod_p(temp[j]);
+
+            if (!visit(offset, &temp[0], std::min(m, end - offset)))
+                break;
         }
+    }
 
-        for (size_t i = 1; i < pntt_blocks - 1; ++i) {
-            auto p = &block[i * ecc_len];
-            ct_butterfly_residue(&_roots_ecc[0], &p[0], ecc_len);
+    /**
+     * ecc[j] * mix[j] followed by the inverse ecc NTT (RBO output), used by the encoder
+     * ecc: residues with |x| < bound, canonical output
+     */
+    template<typename GFT>
+    inline void ecc_mix_residue(GFT *const ecc, const ::GFT *const mix, const ::GFT *const mix_q, uint64_t bound) const {
+        (this->*_ecc_dispatch<GFT>().ecc_mix_residue[_ecc_fixed_log])(ecc, mix, mix_q, bound);
+    }
+
+    /**
+     * Transforms of length `ecc_len`, specialized at compile time for N = ecc_len
+     * (unrolled, roots from ntt_fixed_roots), N = 0 is the generic version.
+     * Indexed by `_ecc_fixed_log`.
+     */
+    template<typename GFT>
+    struct _ecc_dispatch_t {
+        static constexpr size_t size = __builtin_ctzl(max_fixed_ecc_len) + 1;
+
+        uint64_t (NTT::*pntt_residue[size])(const GFT *, size_t, GFT *, GFT *) const = {};
+        void (NTT::*pintt_ecc[size])(GFT *) const = {};
+        void (NTT::*ecc_mix_residue[size])(GFT *, const ::GFT *, const ::GFT *, uint64_t) const = {};
+        void (NTT::*nttr[size])(GFT *) const = {};
+        void (NTT::*inttr[size])(GFT *) const = {};
+
+        constexpr _ecc_dispatch_t() { fill(); }
+
+        template<size_t Log = 0>
+        constexpr void fill() {
+            constexpr size_t N = Log ? size_t(1) << Log : 0;
+            pntt_residue[Log] = &NTT::_pntt_residue_n<N, GFT>;
+            pintt_ecc[Log] = &NTT::_pintt_ecc_n<N, GFT>;
+            ecc_mix_residue[Log] = &NTT::_ecc_mix_residue_n<N, GFT>;
+            nttr[Log] = &NTT::_nttr_n<N, GFT>;
+            inttr[Log] = &NTT::_inttr_n<N, GFT>;
+
+            if constexpr (Log + 1 < size)
+                fill<Log + 1>();
+        }
+    };
 
-            for (size_t j = 0; j < ecc_len; ++j)
-                p[j] = gf.mul_residue(gf.mod_p(p[j]), _pntt_shift[i * ecc_len + j]);
+    template<typename GFT>
+    static inline _ecc_dispatch_t<GFT> const& _ecc_dispatch() {
+        static constexpr _ecc_dispatch_t<GFT> dispatch = {};
+        return dispatch;
+    }
 
-            for (size_t j = 0; j < ecc_len; ++j)
-                block[j] = gf.add_residue(block[j], block[i * ecc_len + j]);
+    /**
+     * f(std::integral_constant<size_t, N>) with N = ecc_len as in _ecc_dispatch_t,
+     * for kernels that are templates on a callback
+     */
+    template<size_t Log = 0, typename F>
+    inline auto _ecc_fixed(F&& f) const {
+        if constexpr (Log + 1 < _ecc_dispatch_t<::GFT>::size) {
+            if (_ecc_fixed_log != Log)
+                return _ecc_fixed<Log + 1>(f);
         }
+        return f(std::integral_constant<size_t, Log ? size_t(1) << Log : 0>{});
     }
 
     /**
-     * partial iNTT
-     * computes the full iNTT from the first `ecc_len` symbols of `block`
-     * normal order input, RBO output
+     * CT butterfly of length ecc_len on the ecc roots, residue input with |x| < Bound
      */
-    template<typename GFT>
-    inline void pintt_ecc(GFT *const ntt_block) const {
-        for (size_t i = 1; i < block_len / ecc_len; ++i) {
-            std::copy_n(&ntt_block[0], ecc_len, &ntt_block[i * ecc_len]);
-            for (size_t j = 0; j < ecc_len; ++j)
-                ntt_block[i * ecc_len + j] = gf.mul(ntt_block[i * ecc_len + j], _pintt_shift[i * ecc_len + j]);
+    template<size_t N, bool Inverse, uint64_t Bound, typename GFT>
+    inline uint64_t _ecc_ct(GFT *const block) const {
+        if constexpr (N != 0)
+            return _ct_butterfly_fixed<N, ntt_fixed_roots<N, Inverse>, Bound>(block);
+        else if constexpr (Inverse)
+            return ct_butterfly_residue(_tw_i_ecc, block, ecc_len, Bound);
+        else
+            return ct_butterfly_residue(_tw_ecc, block, ecc_len, Bound);
+    }
+
+    /**
+     * GS butterfly of length ecc_len on the ecc roots, residue input with |x| < Bound
+     */
+    template<size_t N, bool Inverse, uint64_t Bound, typename GFT>
+    inline uint64_t _ecc_gs(GFT *const block) const {
+        if constexpr (N != 0)
+            return _gs_butterfly_fixed<N, ntt_fixed_roots<N, Inverse>, Bound>(block);
+        else if constexpr (Inverse)
+            return gs_butterfly_residue(_tw_i_ecc, block, ecc_len, ecc_len, Bound);
+        else
+            return gs_butterfly_residue(_tw_ecc, block, ecc_len, ecc_len, Bound);
+    }
 
-            gs_butterfly(&_roots_i_ecc[0], &ntt_block[i * ecc_len], ecc_len, ecc_len);
+    /**
+     * in place when src == dst, otherwise each sub-block is transformed in
+     * dst (first) or temp (others) and src is left unchanged
+     */
+    template<size_t N, typename GFT>
+    inline uint64_t _pntt_residue_n(const GFT *const src, size_t blocks, GFT *const dst, GFT *const temp) const {
+        const size_t len = N ? N : ecc_len;
+
+        return _pntt_residue_load_n<N>([&](size_t i, GFT *const buf) {
+            if (src == dst)
+                return &dst[i * len];
+
+            std::copy_n(&src[i * len], len, &buf[0]);
+            return &buf[0];
+        }, blocks, dst, temp);
+    }
+
+    /**
+     * load(i, buf): sub-block i, see pntt_message_residue.
+     * buf is dst for the first sub-block and temp for the others.
+     */
+    template<size_t N, typename GFT, typename Load>
+    inline uint64_t _pntt_residue_load_n(Load&& load, size_t blocks, GFT *const dst, GFT *const temp) const {
+        const size_t len = N ? N : ecc_len;
+        uint64_t acc = 0;
+#ifdef FFRS_CHECK_BOUNDS
+        uint32_t lanes = ~uint32_t(0);
+#endif
+
+        auto block = &dst[0];
+        for (size_t i = 0; i < blocks; ++i) {
+            GFT *const p = load(i, i == 0 ? &block[0] : &temp[0]);
+#ifdef FFRS_CHECK_BOUNDS
+            lanes &= _residue_lanes(p, len, 0x10001);
+#endif
+            auto bias = residue_bias(_ecc_ct<N, false, 0x10001>(&p[0]));
+
+            // [0, 2p)
+            for (size_t j = 0; j < len; ++j)
+                p[j] = gf.mul_shoup_residue(p[j] + bias, _pntt_shift[i * len + j], _pntt_shift_q[i * len + j]);
+
+            if (i == 0) {
+                acc = 2 * 0x10001;
+                continue;
+            }
+
+            if (acc + 2 * 0x10001 > residue_max) {
+                for (size_t j = 0; j < len; ++j)
+                    block[j] = gf.mod_p(block[j]);
+                acc = 0x10001;
+            }
+
+            for (size_t j = 0; j < len; ++j)
+                block[j] = gf.add_residue(block[j], p[j]);
+            acc += 2 * 0x10001;
         }
 
-        for (size_t j = 0; j < ecc_len; ++j)
-            ntt_block[j] = gf.mul(ntt_block[j], _pintt_shift[j]);
+#ifdef FFRS_CHECK_BOUNDS
+        _check_residue(block, len, acc, lanes, "pntt_residue");
+#endif
+        return acc;
+    }
+
+    template<size_t N, typename GFT>
+    inline void _pintt_ecc_n(GFT *const ntt_block) const {
+        const size_t len = N ? N : ecc_len;
+
+        for (size_t i = 1; i < block_len / len; ++i) {
+            auto p = &ntt_block[i * len];
+            std::copy_n(&ntt_block[0], len, &p[0]);
+            for (size_t j = 0; j < len; ++j)
+                p[j] = gf.mul_shoup(p[j], _pintt_shift[i * len + j], _pintt_shift_q[i * len + j]);
+
+            _ecc_gs<N, true, 0x10001>(&p[0]);
+            for (size_t j = 0; j < len; ++j)
+                p[j] = gf.mod_p(p[j]);
+        }
 
-        gs_butterfly(&_roots_i_ecc[0], &ntt_block[0], ecc_len, ecc_len);
+        for (size_t j = 0; j < len; ++j)
+            ntt_block[j] = gf.mul_shoup(ntt_block[j], _pintt_shift[j], _pintt_shift_q[j]);
+
+        _ecc_gs<N, true, 0x10001>(&ntt_block[0]);
+        for (size_t j = 0; j < len; ++j)
+            ntt_block[j] = gf.mod_p(ntt_block[j]);
+    }
+
+    template<size_t N, typename GFT>
+    inline void _ecc_mix_residue_n(GFT *const ecc, const ::GFT *const mix, const ::GFT *const mix_q, uint64_t bound) const {
+        const size_t len = N ? N : ecc_len;
+        auto bias = residue_bias(bound);
+
+        // [0, 2p)
+        for (size_t j = 0; j < len; ++j)
+            ecc[j] = gf.mul_shoup_residue(ecc[j] + bias, mix[j], mix_q[j]);
+
+        _ecc_gs<N, true, 2 * 0x10001>(&ecc[0]);
+        for (size_t j = 0; j < len; ++j)
+            ecc[j] = gf.mod_p(ecc[j]);
+    }
+
+    template<size_t N, typename GFT>
+    inline void _nttr_n(GFT *const block) const {
+        const size_t len = N ? N : ecc_len;
+
+        _ecc_gs<N, false, 0x10001>(&block[0]);
+        for (size_t i = 0; i < len; ++i)
+            block[i] = gf.mod_p(block[i]);
+    }
+
+    template<size_t N, typename GFT>
+    inline void _inttr_n(GFT *const block) const {
+        const size_t len = N ? N : ecc_len;
+
+        auto bias = residue_bias(_ecc_ct<N, true, 0x10001>(&block[0]));
+        for (size_t i = 0; i < len; ++i)
+            block[i] = gf.mul_shoup(block[i] + bias, ecc_len_i, ecc_len_i_q);
+    }
+
+    /**
+     * Residue bounds (see the residue notes in galois.hpp)
+     *
+     * If the inputs of a pass satisfy |x| < b, its outputs satisfy |x| < *_pass_bound(b).
+     * The inputs of a pass are reduced with mod_p (b = p) only when its output bound
+     * would exceed `residue_max`. The margin to 2^31 leaves room for `residue_bias`.
+     */
+    static constexpr uint64_t residue_max = 0x80000000 - 4 * 0x10001;
+
+    static constexpr uint64_t radix2_pass_bound(uint64_t b) {
+        return 2 * b;
+    }
+
+    static constexpr uint64_t ct_pass_bound(uint64_t b) {
+        // products are in [0, 2p): j = 0: (a0 + a1) + (a2 + a3), e1 + f1; j > 0: a0 + t1 + (t2 + t3)
+        return std::max({4 * b, 2 * b + 2 * 0x10001, b + 6 * 0x10001});
+    }
+
+    static constexpr uint64_t gs_pass_bound(uint64_t b) {
+        // products are in [0, 2p): (a0 + a2) + (a1 + a3), j = 0: f0 + f1
+        return std::max(4 * b, 2 * b + 2 * 0x10001);
+    }
+
+    /**
+     * smallest multiple of p not below `b`
+     * x + residue_bias(b) is a non-negative mul_shoup_residue operand for |x| < b
+     */
+    static constexpr ::GFT residue_bias(uint64_t b) {
+        return ::GFT((b + 0x10000) / 0x10001 * 0x10001);
     }
 
     /**
      * RBO input, normal order output
      */
     template<typename GFT>
-    inline void ct_butterfly(const ::GFT *const roots, GFT *const block, size_t ntt_len) const {
-        for (size_t stride = 1, exp_f = ntt_len >> 1; stride < ntt_len; stride *= 2, exp_f >>= 1) {
-            for (size_t start = 0; start < ntt_len /*input_size*/; start += stride * 2) {
-                {
-                    // Cooley-Tukey butterfly
-                    auto a = block[start];
-                    auto b = block[start + stride];
-                    block[start] = gf.add(a, b);
-                    block[start + stride] = gf.sub(a, b);
-                }
-                for (size_t i = start + 1; i < start + stride; ++i) {
-                    // j = i - start
-                    auto w = roots[exp_f * (i - start)];
-
-                    // Cooley-Tukey butterfly
-                    auto a = block[i];
-                    auto b = block[i + stride];
-                    auto m = gf.mul(b, w);
-                    block[i] = gf.add(a, m);
-                    block[i + stride] = gf.sub(a, m);
+    inline void ct_butterfly(ntt_twiddles const& tw, GFT *const block, size_t ntt_len) const {
+        _ct_butterfly<false>(tw, block, ntt_len, 0x10001);
+    }
+
+    /**
+     * residue input with |x| < bound, returns the bound of the residue output
+     */
+    template<typename GFT>
+    inline uint64_t ct_butterfly_residue(ntt_twiddles const& tw, GFT *const block, size_t ntt_len, uint64_t bound) const {
+        return _ct_butterfly<true>(tw, block, ntt_len, bound);
+    }
+
+    /**
+     * normal order input, RBO output
+     */
+    template<typename GFT>
+    inline void gs_butterfly(ntt_twiddles const& tw, GFT *const block, size_t ntt_len, size_t end) const {
+        _gs_butterfly<false>(tw, block, ntt_len, end, 0x10001);
+    }
+
+    template<typename GFT>
+    inline uint64_t gs_butterfly_residue(ntt_twiddles const& tw, GFT *const block, size_t ntt_len, size_t end, uint64_t bound) const {
+        return _gs_butterfly<true>(tw, block, ntt_len, end, bound);
+    }
+
+    /**
+     * Radix-4 butterflies: two radix-2 stages per pass, plus one radix-2 pass
+     * (with unit twiddles) if the number of stages is odd.
+     *
+     * Transforms larger than `cache_budget` bytes are computed in two phases (four-step):
+     * passes that stay within `rows` consecutive symbols are done row by row,
+     * the remaining passes are done over tiles of columns spanning all rows.
+     * The butterfly network is the same, only the schedule changes.
+     */
+    template<bool Residue, typename GFT>
+    inline uint64_t _ct_butterfly(ntt_twiddles const& tw, GFT *const block, size_t ntt_len, uint64_t bound) const {
+        const bool odd = __builtin_ctzl(ntt_len) & 1;
+        const size_t budget = cache_budget.load(std::memory_order_relaxed);
+        const size_t rows = _blocked_rows<GFT>(ntt_len, ntt_len, budget);
+#ifdef FFRS_CHECK_BOUNDS
+        const uint32_t lanes = _residue_lanes(block, ntt_len, bound);
+#endif
+
+        _residue_plan plan;
+        if constexpr (Residue) {
+            plan = _residue_plan::ct(ntt_len, bound);
+            bound = plan.bound;
+        }
+
+        auto radix4 = [&](size_t pass, GFT *const group, size_t s, size_t j0, size_t j1) {
+            if (Residue && plan.reduce(pass))
+                _ct_radix4<Residue, true>(tw.pass(s), group, s, tw.w4_neg, plan.bias[pass], j0, j1);
+            else
+                _ct_radix4<Residue, false>(tw.pass(s), group, s, tw.w4_neg, plan.bias[pass], j0, j1);
+        };
+
+        size_t stride = 0;
+        size_t pass = 0;
+        for (size_t row = 0; row < ntt_len; row += rows) {
+            pass = 0;
+            if (odd)
+                _radix2_unit<Residue>(&block[row], rows, plan.reduce(pass++));
+
+            stride = odd ? 2 : 1;
+            for (; stride * 4 <= rows; stride *= 4, ++pass) {
+                for (size_t start = row; start < row + rows; start += stride * 4)
+                    radix4(pass, &block[start], stride, 0, stride);
+            }
+        }
+
+        if (stride >= ntt_len) {
+#ifdef FFRS_CHECK_BOUNDS
+            if constexpr (Residue)
+                _check_residue(block, ntt_len, bound, lanes, "ct_butterfly_residue");
+#endif
+            return bound;
+        }
+
+        const size_t cols = _blocked_cols<GFT>(ntt_len, rows, budget);
+        for (size_t col = 0; col < rows; col += cols) {
+            for (size_t s = stride, ps = pass; s < ntt_len; s *= 4, ++ps) {
+                for (size_t start = 0; start < ntt_len; start += s * 4) {
+                    for (size_t base = col; base < s; base += rows)
+                        radix4(ps, &block[start], s, base, base + cols);
                 }
             }
         }
+
+#ifdef FFRS_CHECK_BOUNDS
+        if constexpr (Residue)
+            _check_residue(block, ntt_len, bound, lanes, "ct_butterfly_residue");
+#endif
+        return bound;
     }
 
-    template<typename GFT>
-    inline void ct_butterfly_residue(const ::GFT *const roots, GFT *const block, size_t ntt_len) const {
-        for (size_t stride = 1, exp_f = ntt_len >> 1; stride < ntt_len; stride *= 2, exp_f >>= 1) {
-            for (size_t start = 0; start < ntt_len /*input_size*/; start += stride * 2) {
-                {
-                    // Cooley-Tukey butterfly
-                    auto a = block[start];
-                    auto b = block[start + stride];
-                    block[start] = gf.add_residue(a, b);
-                    block[start + stride] = gf.sub_residue(a, b);
-                }
-                for (size_t i = start + 1; i < start + stride; ++i) {
-                    // j = i - start
-                    auto w = roots[exp_f * (i - start)];
-
-                    // Cooley-Tukey butterfly
-                    auto a = block[i];
-                    auto b = block[i + stride];
-                    auto m = gf.mul_residue(gf.mod_p(b), w);
-                    block[i] = gf.add_residue(a, m);
-                    block[i + stride] = gf.sub_residue(a, m);
+    template<bool Residue, typename GFT>
+    inline uint64_t _gs_butterfly(ntt_twiddles const& tw, GFT *const block, size_t ntt_len, size_t end, uint64_t bound) const {
+        const bool odd = __builtin_ctzl(ntt_len) & 1;
+        const size_t budget = cache_budget.load(std::memory_order_relaxed);
+        const size_t rows = _blocked_rows<GFT>(ntt_len, end, budget);
+#ifdef FFRS_CHECK_BOUNDS
+        const uint32_t lanes = _residue_lanes(block, end, bound);
+#endif
+
+        _residue_plan plan;
+        if constexpr (Residue) {
+            plan = _residue_plan::gs(ntt_len, bound);
+            bound = plan.bound;
+        }
+
+        auto radix4 = [&](size_t pass, GFT *const group, size_t s, size_t j0, size_t j1) {
+            if (Residue && plan.reduce(pass))
+                _gs_radix4<Residue, true>(tw.pass(s), group, s, tw.w4_neg, plan.bias[pass], j0, j1);
+            else
+                _gs_radix4<Residue, false>(tw.pass(s), group, s, tw.w4_neg, plan.bias[pass], j0, j1);
+        };
+
+        size_t stride = ntt_len / 4;
+        size_t pass = 0;
+        if (rows < ntt_len) {
+            const size_t cols = _blocked_cols<GFT>(ntt_len, rows, budget);
+            for (size_t col = 0; col < rows; col += cols) {
+                for (size_t s = stride, ps = 0; s * 4 > rows; s /= 4, ++ps) {
+                    for (size_t start = 0; start < ntt_len; start += s * 4) {
+                        for (size_t base = col; base < s; base += rows)
+                            radix4(ps, &block[start], s, base, base + cols);
+                    }
                 }
             }
+            for (; stride * 4 > rows; stride /= 4, ++pass);
+        }
+
+        for (size_t row = 0; row < end; row += rows) {
+            size_t ps = pass;
+            for (size_t s = stride; s > 0; s /= 4, ++ps) {
+                for (size_t start = row; start < std::min(row + rows, end); start += s * 4)
+                    radix4(ps, &block[start], s, 0, s);
+            }
+
+            if (odd)
+                _radix2_unit<Residue>(&block[row], std::min(rows, end - row), plan.reduce(ps));
         }
+
+#ifdef FFRS_CHECK_BOUNDS
+        if constexpr (Residue)
+            _check_residue(block, end, bound, lanes, "gs_butterfly_residue");
+#endif
+        return bound;
     }
 
     /**
-     * normal order input, RBO output
+     * _ct_butterfly_residue for a compile-time length and roots (ntt_fixed_roots),
+     * fully unrolled, without cache blocking
+     */
+    template<size_t N, typename Roots, uint64_t Bound, typename GFT>
+    inline uint64_t _ct_butterfly_fixed(GFT *const block) const {
+        constexpr bool odd = __builtin_ctzl(N) & 1;
+        constexpr auto plan = _residue_plan::ct(N, Bound);
+#ifdef FFRS_CHECK_BOUNDS
+        const uint32_t lanes = _residue_lanes(block, N, Bound);
+#endif
+
+        if constexpr (odd)
+            _radix2_unit<true>(block, N, plan.reduce(0));
+
+        [&]<size_t... P>(std::index_sequence<P...>) {
+            (this->template _ct_fixed_pass<N, Roots, ((odd ? 2 : 1) << (2 * P)), plan.reduce(P + odd), plan.bias[P + odd]>(block), ...);
+        }(std::make_index_sequence<__builtin_ctzl(N) / 2>{});
+
+#ifdef FFRS_CHECK_BOUNDS
+        _check_residue(block, N, plan.bound, lanes, "ct_butterfly_fixed");
+#endif
+        return plan.bound;
+    }
+
+    template<size_t N, typename Roots, uint64_t Bound, typename GFT>
+    inline uint64_t _gs_butterfly_fixed(GFT *const block) const {
+        constexpr bool odd = __builtin_ctzl(N) & 1;
+        constexpr size_t passes = __builtin_ctzl(N) / 2;
+        constexpr auto plan = _residue_plan::gs(N, Bound);
+#ifdef FFRS_CHECK_BOUNDS
+        const uint32_t lanes = _residue_lanes(block, N, Bound);
+#endif
+
+        [&]<size_t... P>(std::index_sequence<P...>) {
+            (this->template _gs_fixed_pass<N, Roots, ((N / 4) >> (2 * P)), plan.reduce(P), plan.bias[P]>(block), ...);
+        }(std::make_index_sequence<passes>{});
+
+        if constexpr (odd)
+            _radix2_unit<true>(block, N, plan.reduce(passes));
+
+#ifdef FFRS_CHECK_BOUNDS
+        _check_residue(block, N, plan.bound, lanes, "gs_butterfly_fixed");
+#endif
+        return plan.bound;
+    }
+
+    template<size_t N, typename Roots, size_t Stride, bool Reduce, ::GFT Bias, typename GFT>
+    inline void _ct_fixed_pass(GFT *const block) const {
+#pragma GCC unroll 64
+        for (size_t start = 0; start < N; start += Stride * 4)
+            _ct_radix4<true, Reduce>(Roots::pass(Stride), &block[start], Stride, Roots::w4_neg, Bias, 0, Stride);
+    }
+
+    template<size_t N, typename Roots, size_t Stride, bool Reduce, ::GFT Bias, typename GFT>
+    inline void _gs_fixed_pass(GFT *const block) const {
+#pragma GCC unroll 64
+        for (size_t start = 0; start < N; start += Stride * 4)
+            _gs_radix4<true, Reduce>(Roots::pass(Stride), &block[start], Stride, Roots::w4_neg, Bias, 0, Stride);
+    }
+
+    /**
+     * FFRS_CHECK_BOUNDS: mask of the lanes of `block[0, len)` whose residues are all below `bound`,
+     * lanes not in use (e.g. partial interleave stripes) are excluded from the checks
      */
     template<typename GFT>
-    inline void gs_butterfly(const ::GFT *const roots, GFT *const block, size_t ntt_len, size_t end) const {
-        for (size_t stride = ntt_len / 2, exp_f = 0; stride > 0; stride /= 2, exp_f += 1) {
-            for (size_t start = 0; start < end; start += stride * 2) {
-                {
-                    // Gentleman-Sande butterfly
-                    auto a = block[start];
-                    auto b = block[start + stride];
-                    block[start] = gf.add(a, b);
-                    block[start + stride] = gf.sub(a, b);
-                }
-                for (size_t i = start + 1; i < start + stride; ++i) {
-                    // Gentleman-Sande butterfly
-                    auto w = roots[(i - start) << exp_f];
-
-                    auto a = block[i];
-                    auto b = block[i + stride];
-                    block[i] = gf.add(a, b);
-                    block[i + stride] = gf.mul(gf.sub(a, b), w);
-                }
-            }
+    inline uint32_t _residue_lanes(const GFT *const block, size_t len, uint64_t bound) const {
+        constexpr size_t lanes = sizeof(GFT) / sizeof(::GFT);
+        auto res = reinterpret_cast<const int32_t *>(&block[0]);
+        uint32_t mask = (uint32_t(1) << lanes) - 1;
+        for (size_t i = 0; i < len * lanes; ++i) {
+            if (uint64_t(std::abs(int64_t(res[i]))) >= bound)
+                mask &= ~(uint32_t(1) << (i % lanes));
         }
+        return mask;
     }
 
+    /**
+     * FFRS_CHECK_BOUNDS: throws if a residue of the lanes in `mask` is not below `bound`
+     */
     template<typename GFT>
-    inline void gs_butterfly_residue(const ::GFT *const roots, GFT *const block, size_t ntt_len, size_t end) const {
-        for (size_t stride = ntt_len / 2, exp_f = 0; stride > 0; stride /= 2, exp_f += 1) {
-            for (size_t start = 0; start < end; start += stride * 2) {
-                {
-                    // Gentleman-Sande butterfly
-                    auto a = block[start];
-                    auto b = block[start + stride];
-                    block[start] = gf.add_residue(a, b);
-                    block[start + stride] = gf.sub_residue(a, b);
-                }
-                for (size_t i = start + 1; i < start + stride; ++i) {
-                    // Gentleman-Sande butterfly
-                    auto w = roots[(i - start) << exp_f];
-
-                    auto a = block[i];
-                    auto b = block[i + stride];
-                    block[i] = gf.add_residue(a, b);
-                    block[i + stride] = gf.mul_residue(gf.mod_p(gf.sub_residue(a, b)), w);
-                }
+    inline void _check_residue(const GFT *const block, size_t len, uint64_t bound, uint32_t mask, const char *location) const {
+        constexpr size_t lanes = sizeof(GFT) / sizeof(::GFT);
+        auto res = reinterpret_cast<const int32_t *>(&block[0]);
+        for (size_t i = 0; i < len * lanes; ++i) {
+            if ((mask >> (i % lanes) & 1) && uint64_t(std::abs(int64_t(res[i]))) >= bound) {
+                throw std::runtime_error(
+                    std::string(location) + ": residue "
+                    + std::to_string(res[i]) + " exceeds " + std::to_string(bound)
+                );
             }
         }
     }
 
+    /**
+     * per-pass reductions and biases of a residue butterfly
+     */
+    struct _residue_plan {
+        uint32_t reduce_mask = 0;
+        std::array<::GFT, 16> bias = {};
+        size_t passes = 0;
+        uint64_t bound = 0x10001;
+
+        static constexpr _residue_plan ct(size_t ntt_len, uint64_t bound) {
+            _residue_plan plan;
+            plan.bound = bound;
+            const bool odd = __builtin_ctzl(ntt_len) & 1;
+            if (odd)
+                plan.add(radix2_pass_bound, 0);
+            for (size_t s = odd ? 2 : 1; s < ntt_len; s *= 4)
+                plan.add(ct_pass_bound, 2);
+            return plan;
+        }
+
+        static constexpr _residue_plan gs(size_t ntt_len, uint64_t bound) {
+            _residue_plan plan;
+            plan.bound = bound;
+            for (size_t s = ntt_len / 4; s > 0; s /= 4)
+                plan.add(gs_pass_bound, 4);
+            if (__builtin_ctzl(ntt_len) & 1)
+                plan.add(radix2_pass_bound, 0);
+            return plan;
+        }
+
+        /**
+         * appends a pass with the given bound, whose multiplication operands are
+         * residues below `operand` times its input bound
+         */
+        constexpr void add(uint64_t (*pass_bound)(uint64_t), uint64_t operand) {
+            if (pass_bound(bound) > residue_max) {
+                reduce_mask |= 1u << passes;
+                bound = 0x10001;
+            }
+            bias[passes] = residue_bias(operand * bound);
+            bound = pass_bound(bound);
+            ++passes;
+        }
+
+        constexpr bool reduce(size_t pass) const {
+            return (reduce_mask >> pass) & 1;
+        }
+    };
+
+    /**
+     * number of consecutive symbols transformed together in the first phase
+     * (last phase for GS), `ntt_len` if the transform fits in `budget` bytes
+     */
+    template<typename GFT>
+    inline size_t _blocked_rows(size_t ntt_len, size_t end, size_t budget) const {
+        if (end != ntt_len || ntt_len * sizeof(GFT) <= budget)
+            return ntt_len;
+
+        // keep the pass boundaries: rows = ntt_len / 4^k
+        size_t rows = ntt_len;
+        while (rows * sizeof(GFT) > budget && rows >= 64)
+            rows /= 4;
+        return rows;
+    }
+
+    /**
+     * number of columns per tile in the second phase (first phase for GS)
+     */
+    template<typename GFT>
+    inline size_t _blocked_cols(size_t ntt_len, size_t rows, size_t budget) const {
+        size_t min_cols = std::max<size_t>(1, 64 / sizeof(GFT));
+        size_t cols = std::max<size_t>(min_cols, budget / sizeof(GFT) / (ntt_len / rows));
+        cols = std::min(size_t(1) << ffrs::detail::ilog2_floor(cols), rows);
+        return cols;
+    }
+
+    template<bool Reduce, typename T>
+    inline T _load(T const& a) const {
+        if constexpr (Reduce)
+            return gf.mod_p(a);
+        else
+            return a;
+    }
+
+    template<bool Residue, typename T>
+    inline T _add(T const& a, T const& b) const {
+        if constexpr (Residue)
+            return gf.add_residue(a, b);
+        else
+            return gf.add(a, b);
+    }
+
+    template<bool Residue, typename T>
+    inline T _sub(T const& a, T const& b) const {
+        if constexpr (Residue)
+            return gf.sub_residue(a, b);
+        else
+            return gf.sub(a, b);
+    }
+
+    template<bool Residue, typename T>
+    inline T _mul(T const& a, ::GFT const& w, ::GFT const& wq, ::GFT const& bias) const {
+        if constexpr (Residue)
+            return gf.mul_shoup_residue(a + bias, w, wq);
+        else
+            return gf.mul_shoup(a, w, wq);
+    }
+
+    /**
+     * a * w4, computes `b - a` instead of `a - b` before the call when w4 = -256
+     */
+    template<bool Residue, typename T>
+    inline T _mul_w4(T const& a, ::GFT const& bias) const {
+        if constexpr (Residue)
+            return gf.mul_shoup_residue(a + bias, 256, ::GFT((uint64_t(256) << 32) / 0x10001));
+        else
+            return gf.mul_pow2(a, 8);
+    }
+
+    template<bool Residue, typename GFT>
+    inline void _radix2_unit(GFT *const block, size_t len, bool reduce) const {
+        if (Residue && reduce) {
+            for (size_t start = 0; start < len; ++start)
+                block[start] = gf.mod_p(block[start]);
+        }
+
+        for (size_t start = 0; start < len; start += 2) {
+            auto a = block[start];
+            auto b = block[start + 1];
+            block[start] = _add<Residue>(a, b);
+            block[start + 1] = _sub<Residue>(a, b);
+        }
+    }
+
+    /**
+     * Cooley-Tukey radix-4 butterflies of the group starting at `block`, for offsets [j0, j1)
+     */
+    template<bool Residue, bool Reduce, typename GFT>
+    inline void _ct_radix4(const ::GFT *const tw, GFT *const block,
+            size_t stride, bool w4_neg, ::GFT bias, size_t j0, size_t j1) const {
+        if (j0 == 0) {
+            auto a0 = _load<Reduce>(block[0]);
+            auto a1 = _load<Reduce>(block[stride]);
+            auto a2 = _load<Reduce>(block[stride * 2]);
+            auto a3 = _load<Reduce>(block[stride * 3]);
+            auto e0 = _add<Residue>(a0, a1);
+            auto e1 = _sub<Residue>(a0, a1);
+            auto f0 = _add<Residue>(a2, a3);
+            auto f1 = _mul_w4<Residue>(w4_neg ? _sub<Residue>(a3, a2) : _sub<Residue>(a2, a3), bias);
+            block[0] = _add<Residue>(e0, f0);
+            block[stride] = _add<Residue>(e1, f1);
+            block[stride * 2] = _sub<Residue>(e0, f0);
+            block[stride * 3] = _sub<Residue>(e1, f1);
+            j0 = 1;
+        }
+        for (size_t j = j0; j < j1; ++j) {
+            // w^j, w^2j, w^3j
+            auto w = &tw[j * 6];
+
+            auto a0 = _load<Reduce>(block[j]);
+            auto t1 = _mul<Residue>(_load<Reduce>(block[j + stride]), w[2], w[3], bias);
+            auto t2 = _mul<Residue>(_load<Reduce>(block[j + stride * 2]), w[0], w[1], bias);
+            auto t3 = _mul<Residue>(_load<Reduce>(block[j + stride * 3]), w[4], w[5], bias);
+            auto e0 = _add<Residue>(a0, t1);
+            auto e1 = _sub<Residue>(a0, t1);
+            auto f0 = _add<Residue>(t2, t3);
+            auto f1 = _mul_w4<Residue>(w4_neg ? _sub<Residue>(t3, t2) : _sub<Residue>(t2, t3), bias);
+            block[j] = _add<Residue>(e0, f0);
+            block[j + stride] = _add<Residue>(e1, f1);
+            block[j + stride * 2] = _sub<Residue>(e0, f0);
+            block[j + stride * 3] = _sub<Residue>(e1, f1);
+        }
+    }
+
+    /**
+     * Gentleman-Sande radix-4 butterflies of the group starting at `block`, for offsets [j0, j1)
+     */
+    template<bool Residue, bool Reduce, typename GFT>
+    inline void _gs_radix4(const ::GFT *const tw, GFT *const block,
+            size_t stride, bool w4_neg, ::GFT bias, size_t j0, size_t j1) const {
+        if (j0 == 0) {
+            auto a0 = _load<Reduce>(block[0]);
+            auto a1 = _load<Reduce>(block[stride]);
+            auto a2 = _load<Reduce>(block[stride * 2]);
+            auto a3 = _load<Reduce>(block[stride * 3]);
+            auto e0 = _add<Residue>(a0, a2);
+            auto e1 = _add<Residue>(a1, a3);
+            auto f0 = _sub<Residue>(a0, a2);
+            auto f1 = _mul_w4<Residue>(w4_neg ? _sub<Residue>(a3, a1) : _sub<Residue>(a1, a3), bias);
+            block[0] = _add<Residue>(e0, e1);
+            block[stride] = _sub<Residue>(e0, e1);
+            block[stride * 2] = _add<Residue>(f0, f1);
+            block[stride * 3] = _sub<Residue>(f0, f1);
+            j0 = 1;
+        }
+        for (size_t j = j0; j < j1; ++j) {
+            // w^j, w^2j, w^3j
+            auto w = &tw[j * 6];
+
+            auto a0 = _load<Reduce>(block[j]);
+            auto a1 = _load<Reduce>(block[j + stride]);
+            auto a2 = _load<Reduce>(block[j + stride * 2]);
+            auto a3 = _load<Reduce>(block[j + stride * 3]);
+            auto e0 = _add<Residue>(a0, a2);
+            auto e1 = _add<Residue>(a1, a3);
+            auto f0 = _sub<Residue>(a0, a2);
+            auto f1 = _mul_w4<Residue>(w4_neg ? _sub<Residue>(a3, a1) : _sub<Residue>(a1, a3), bias);
+            block[j] = _add<Residue>(e0, e1);
+            block[j + stride] = _mul<Residue>(_sub<Residue>(e0, e1), w[2], w[3], bias);
+            block[j + stride * 2] = _mul<Residue>(_add<Residue>(f0, f1), w[0], w[1], bias);
+            block[j + stride * 3] = _mul<Residue>(_sub<Residue>(f0, f1), w[4], w[5], bias);
+        }
+    }
+
     template<typename GFT>
     inline void _reverse_ntt(GFT *const vec, size_t shift) const {
         // check_le_ecc(shift);
@@ -335,8 +1133,8 @@ struct NTT {
             auto k = _rbo_ecc[ecc_len - j];
             if (i < k)
                 std::swap(vec[i], vec[k]);
-            vec[i] = gf.mul(vec[i], _roots_i_ecc[j]);
-            vec[i] = gf.mul(vec[i], _roots_ecc[shift * j & ecc_len_mask]);
+            vec[i] = gf.mul_shoup(vec[i], _roots_i_ecc[j], _roots_i_ecc_q[j]);
+            vec[i] = gf.mul_shoup(vec[i], _roots_ecc[shift * j & ecc_len_mask], _roots_ecc_q[shift * j & ecc_len_mask]);
         }
     }
 
@@ -348,7 +1146,7 @@ struct NTT {
             auto k = _rbo_ecc[ecc_len - j];
             if (i < k)
                 std::swap(vec[i], vec[k]);
-            vec[i] = gf.mul(vec[i], _roots_i_ecc[j]);
+            vec[i] = gf.mul_shoup(vec[i], _roots_i_ecc[j], _roots_i_ecc_q[j]);
             vec[i] = gf.mul(vec[i], gf.gather(&_roots_ecc[0], shift * j & ::GFT(ecc_len_mask)));
         }
     }
@@ -568,26 +1366,26 @@ struct NTT {
      */
     template<typename GFT>
     inline void nttr(GFT *const block) const {
-        gs_butterfly(&_roots_ecc[0], &block[0], ecc_len, ecc_len);
+        (this->*_ecc_dispatch<GFT>().nttr[_ecc_fixed_log])(block);
     }
 
     template<typename GFT>
     inline void inttr(GFT *const block) const {
-        ct_butterfly(&_roots_i_ecc[0], &block[0], ecc_len);
-        for (size_t i = 0; i < ecc_len; ++i)
-            block[i] = gf.mul(block[i], ecc_len_i);
+        (this->*_ecc_dispatch<GFT>().inttr[_ecc_fixed_log])(block);
     }
 
     template<typename GFT>
     inline void nttr2(GFT *const block) const {
-        gs_butterfly(&_roots_ecc2[0], &block[0], ecc_len * 2, ecc_len * 2);
+        gs_butterfly_residue(_tw_ecc2, &block[0], ecc_len * 2, ecc_len * 2, 0x10001);
+        for (size_t i = 0; i < ecc_len * 2; ++i)
+            block[i] = gf.mod_p(block[i]);
     }
 
     template<typename GFT>
     inline void inttr2(GFT *const block) const {
-        ct_butterfly(&_roots_i_ecc2[0], &block[0], ecc_len * 2);
+        auto bias = residue_bias(ct_butterfly_residue(_tw_i_ecc2, &block[0], ecc_len * 2, 0x10001));
         for (size_t i = 0; i < ecc_len * 2; ++i)
-            block[i] = gf.mul(block[i], ecc2_len_i);
+            block[i] = gf.mul_shoup(block[i] + bias, ecc2_len_i, ecc2_len_i_q);
     }
 
     /**
@@ -595,14 +1393,16 @@ struct NTT {
      */
     template<typename GFT>
     inline void ntt(GFT *const block) const {
-        ct_butterfly(&_roots_ntt[0], &block[0], ntt_len);
+        ct_butterfly_residue(_tw_ntt, &block[0], ntt_len, 0x10001);
+        for (size_t i = 0; i < ntt_len; ++i)
+            block[i] = gf.mod_p(block[i]);
     }
 
     template<typename GFT>
     inline void intt(GFT *const block) const {
-        gs_butterfly(&_roots_i_ntt[0], &block[0], ntt_len, ntt_len);
+        auto bias = residue_bias(gs_butterfly_residue(_tw_i_ntt, &block[0], ntt_len, ntt_len, 0x10001));
         for (size_t i = 0; i < ntt_len; ++i)
-            block[i] = gf.mul(block[i], ntt_len_i);
+            block[i] = gf.mul_shoup(block[i] + bias, ntt_len_i, ntt_len_i_q);
     }
 
     template<typename GFT>
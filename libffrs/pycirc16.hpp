@@ -34,6 +34,8 @@ class PyCIRC16 {
 private:
     PyRSi16 rsi;
     PyRSi16 rso;
+    // storage for encode(reuse_output=True)
+    reusable_output _output;
 
 public:
     const size_t block_len;
@@ -52,10 +54,11 @@ public:
         size_t primitive,
         std::optional<bool> simd_x4,
         std::optional<bool> simd_x8,
-        std::optional<bool> simd_x16
+        std::optional<bool> simd_x16,
+        size_t threads = 1
     ):
-        rsi(inner_block_len, inner_ecc_len, 1, primitive, simd_x4, simd_x8, simd_x16),
-        rso(outer_block_len, outer_ecc_len, rsi.message_len * interleave, primitive, simd_x4, simd_x8, simd_x16),
+        rsi(inner_block_len, inner_ecc_len, 1, primitive, simd_x4, simd_x8, simd_x16, threads),
+        rso(outer_block_len, outer_ecc_len, rsi.message_len * interleave, primitive, simd_x4, simd_x8, simd_x16, threads),
         block_len(inner_block_len * outer_block_len * interleave),
         message_len(rso.interleaved_message_len),
         rsi_interleaved_ecc_len(rsi.ecc_len * rso.message_len * interleave),
@@ -77,7 +80,8 @@ public:
                     GFT,  // primitive
                     std::optional<bool>,  // simd_x4
                     std::optional<bool>,  // simd_x8
-                    std::optional<bool>   // simd_x16
+                    std::optional<bool>,  // simd_x16
+                    size_t                // threads
                 >(),
                 R"(Cross-interleaved Reed-Solomon coder)",
                 "inner_block_len"_a,
@@ -89,7 +93,8 @@ public:
                 "primitive"_a = 3,
                 "simd_x4"_a = py::none(),
                 "simd_x8"_a = py::none(),
-                "simd_x16"_a = py::none()
+                "simd_x16"_a = py::none(),
+                "threads"_a = 1
             )
 
             .def_property_readonly("rsi", [](PyCIRC16& self) -> auto const& { return self.rsi; }, R"(Inner Reed-Solomon codec (:class:`RSi16`))")
@@ -116,10 +121,17 @@ public:
             .def("__sizeof_cpp__", [](PyCIRC16& self) { return sizeof(self); }, R"(Size of object in bytes)")
             .def_property_readonly("simd_x4", [](PyCIRC16& self) { return self.rsi.simd_x4; }, R"(SIMD x4 encoding enabled (SSE2))")
             .def_property_readonly("simd_x8", [](PyCIRC16& self) { return self.rsi.simd_x8; }, R"(SIMD x8 encoding enabled (AVX2))")
-            .def_property_readonly("simd_x16", [](PyCIRC16& self) { return self.rsi.simd_x16; }, R"(SIMD x16 encoding enabled (AVX512))")
-
-            .def("encode", cast_args(&PyCIRC16::py_encode), R"(Encode data)", "buffer"_a)
-            .def("repair", cast_args(&PyCIRC16::py_repair), R"(Repair data)", "message"_a, "ecc"_a)
+            .def_property_readonly("simd_x16", [](PyCIRC16& self) { return self.rsi.simd_x16; }, R"(SIMD x16 encoding enabled (AVX-512F, or two AVX2 vectors))")
+            .def_property_readonly("threads", [](PyCIRC16& self) { return self.rsi.threads; }, R"(Default number of encoder threads)")
+
+            .def("encode", cast_args(&PyCIRC16::py_encode),
+                R"(Encode data. With reuse_output, return a memoryview into a codec-owned buffer, overwritten by the next such call from the same thread)",
+                "buffer"_a, py::kw_only(), "reuse_output"_a = false, "workspace"_a = py::none())
+            .def("encode_into", cast_args(&PyCIRC16::py_encode_into),
+                R"(Encode data into the writable buffer ecc_out, which must not overlap buffer. Return the number of bytes written)",
+                "buffer"_a, "ecc_out"_a, py::kw_only(), "workspace"_a = py::none())
+            .def("repair", cast_args(&PyCIRC16::py_repair), R"(Repair data)",
+                "message"_a, "ecc"_a, py::kw_only(), "workspace"_a = py::none())
             .def("_find_outer_error_locations", cast_args(&PyCIRC16::py_find_outer_error_locations),
                 R"(Find outer codec error locations for a given interleaved block)", "message"_a, "ecc"_a, "interleave"_a)
 
@@ -133,7 +145,7 @@ public:
 
 private:
     struct CircRepair {
-        using Buffer = decltype(new_aligned<GFT>(0, 0));
+        using Buffer = workspace::buffer<GFT>;
         PyCIRC16 const& circ;
         PyRSi16 const& rsi;
         PyRSi16 const& rso;
@@ -143,16 +155,19 @@ private:
         Buffer rso_ecc;
         Buffer rsi_ecc;
         GFT *rsio_ecc;
+        // erasures of the last outer repair, reused while the following
+        // interleaves have the same locations
+        std::optional<ErasurePlan> outer_plan;
 
         inline CircRepair(PyCIRC16 const& circ):
             circ(circ),
             rsi(circ.rsi),
             rso(circ.rso),
-            rsi_temp(new_aligned<GFT>(rsi.block_len, rsi.vec_align)),
-            rsi_repair_temp(new_aligned<GFT>(rsi.repair_temp_len, rsi.vec_align)),
-            rsi_synd(new_aligned<GFT>(rso.block_len * rsi.ecc_len * circ.interleave, rsi.vec_align)),
-            rso_ecc(new_aligned<GFT>(rso.interleaved_ecc_len, rsi.vec_align)),
-            rsi_ecc(new_aligned<GFT>(rsi.ecc_len * rso.block_len * circ.interleave, rsi.vec_align)),
+            rsi_temp(workspace::current().alloc<GFT>(rsi.block_len, rsi.vec_align)),
+            rsi_repair_temp(workspace::current().alloc<GFT>(rsi.repair_temp_len, rsi.vec_align)),
+            rsi_synd(workspace::current().alloc<GFT>(rso.block_len * rsi.ecc_len * circ.interleave, rsi.vec_align)),
+            rso_ecc(workspace::current().alloc<GFT>(rso.interleaved_ecc_len, rsi.vec_align)),
+            rsi_ecc(workspace::current().alloc<GFT>(rsi.ecc_len * rso.block_len * circ.interleave, rsi.vec_align)),
             rsio_ecc(&rsi_ecc[circ.rsi_interleaved_ecc_len])
         { }
 
@@ -167,14 +182,12 @@ private:
                 &message[0],
                 &rsi_ecc[0],
                 rso.message_len * circ.interleave,
-                &rsi_temp[0],
                 &rsi_synd[0]
             );
             rsi.synd_blocks(
                 &rso_ecc[0],
                 &rsio_ecc[0],
                 rso.ecc_len * circ.interleave,
-                &rsi_temp[0],
                 &rsi_synd[circ.rsi_interleaved_ecc_len]
             );
             return *this;
@@ -296,10 +309,14 @@ private:
             log_debug("error locations: %s", locations);
 
             if (locations.size() <= rso.ecc_len) {
-                rso.repair_interleaved(&message[0], &rso_ecc[0], interleave * rsi.message_len, rsi.message_len, locations);
+                // rows failing the inner check are erasures, the outer code
+                // still corrects errors the inner code missed
+                if (!outer_plan || outer_plan->error_pos != locations)
+                    outer_plan.emplace(rso.ntt, locations);
+                rso.repair_interleaved(&message[0], &rso_ecc[0], interleave * rsi.message_len, rsi.message_len, *outer_plan, true);
             } else {
                 log_warning("too many errors to repair: interleave:%d count:%d", interleave, locations.size());
-                log_warning("attempting erasure decoding");
+                log_warning("attempting error decoding");
                 rso.repair_interleaved(&message[0], &rso_ecc[0], interleave * rsi.message_len, rsi.message_len);
             }
         }
@@ -334,23 +351,47 @@ private:
         }
     };
 
-    inline py::bytearray py_encode(buffer_ro<uint16_t> buf) {
+    inline py::object py_encode(buffer_ro<uint16_t> buf, bool reuse_output, workspace *ws) {
+        workspace::use scratch(ws);
+
         py_assert(buf.size % message_len == 0, std::to_string(buf.size));
 
         size_t full_blocks = buf.size / message_len;
+        auto [output, output_data] = output_buffer(full_blocks * ecc_len * sizeof(uint16_t),
+                                                   reuse_output ? &_output : nullptr);
 
-        auto output = py::bytearray(nullptr, full_blocks * ecc_len * sizeof(uint16_t));
-        auto output_data = reinterpret_cast<uint16_t *>(PyByteArray_AsString(output.ptr()));
-        auto temp = new_aligned<GFT>(rso.interleaved_ecc_len, rsi.vec_align);
+        encode_blocks(&buf[0], full_blocks, reinterpret_cast<uint16_t *>(output_data));
+        return output;
+    }
 
-        for (size_t i = 0; i < full_blocks; ++i)
-            encode_block(&buf[i * message_len], &output_data[i * ecc_len]);
+    inline size_t py_encode_into(buffer_ro<uint16_t> buf, buffer_out<uint16_t> ecc_out, workspace *ws) {
+        workspace::use scratch(ws);
 
-        return output;
+        py_assert(buf.size % message_len == 0, std::to_string(buf.size));
+
+        size_t full_blocks = buf.size / message_len;
+        size_t output_size = full_blocks * ecc_len;
+        py_assert(ecc_out.size >= output_size, std::to_string(ecc_out.size) + " < " + std::to_string(output_size));
+
+        encode_blocks(&buf[0], full_blocks, &ecc_out[0]);
+        return output_size * sizeof(uint16_t);
+    }
+
+    /**
+     * Encode `full_blocks` CIRC blocks with the GIL released
+     */
+    inline void encode_blocks(const uint16_t src[], size_t full_blocks, uint16_t dst[]) {
+        if (full_blocks == 0)
+            return;
+
+        without_gil([&] {
+            for (size_t i = 0; i < full_blocks; ++i)
+                encode_block(&src[i * message_len], &dst[i * ecc_len]);
+        });
     }
 
     inline void encode_block(const uint16_t src[], uint16_t dst[]) {
-        auto temp = new_aligned<GFT>(rso.interleaved_ecc_len, rsi.vec_align);
+        auto temp = workspace::current().alloc<GFT>(rso.interleaved_ecc_len, rsi.vec_align);
 
         auto rso_ecc = &dst[0];  // size = rso.interleaved_ecc_len
         auto rsi_ecc = &dst[rso.interleaved_ecc_len];  // size = rsi_interleaved_ecc_len
@@ -362,7 +403,9 @@ private:
         rsi.encode_blocks(&temp[0], rso.ecc_len * interleave, &rsio_ecc[0]);
     }
 
-    inline bool py_repair(buffer_rw<uint16_t> message, buffer_rw<uint16_t> ecc) {
+    inline bool py_repair(buffer_rw<uint16_t> message, buffer_rw<uint16_t> ecc, workspace *ws) {
+        workspace::use scratch(ws);
+
         log_debug("message size: %s", message.size);
         log_debug("ecc size: %s", ecc.size);
         py_assert(message.size == message_len, std::to_string(message.size) + " != " + std::to_string(message_len));
@@ -372,13 +415,15 @@ private:
         py_assert(inner_blocks == rso.message_len * interleave);
         log_info("rsi blocks: %s", inner_blocks);
 
-        CircRepair(*this)
-            .load_ecc(&ecc[0])
-            .compute_rsi_synd(&message[0])
-            .repair_all(&message[0])
-            // TODO: sanity check on updated ecc
-            .recompute_inner_ecc(&message[0])
-            .dump_ecc(&ecc[0]);
+        without_gil([&] {
+            CircRepair(*this)
+                .load_ecc(&ecc[0])
+                .compute_rsi_synd(&message[0])
+                .repair_all(&message[0])
+                // TODO: sanity check on updated ecc
+                .recompute_inner_ecc(&message[0])
+                .dump_ecc(&ecc[0]);
+        });
 
         return false;
     }
@@ -394,12 +439,14 @@ private:
         log_info("rsi blocks: %s", inner_blocks);
 
         std::vector<size_t> locations;
-        CircRepair(*this)
-            .load_ecc(&ecc[0])
-            .compute_rsi_synd(&message[0])
-            .repair_outer_zeros(interleave)
-            .repair_inner_zeros(interleave)
-            .find_error_locations(interleave, locations);
+        without_gil([&] {
+            CircRepair(*this)
+                .load_ecc(&ecc[0])
+                .compute_rsi_synd(&message[0])
+                .repair_outer_zeros(interleave)
+                .repair_inner_zeros(interleave)
+                .find_error_locations(interleave, locations);
+        });
 
         return locations;
     }
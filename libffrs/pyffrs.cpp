@@ -17,6 +17,9 @@
  **************************************************************************/
 
 #include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
 
 #include <pybind11/pybind11.h>
 
@@ -113,6 +116,11 @@ PYBIND11_MODULE(libffrs, m) {
 #else
     m.attr("compiler_info") = "unknown";
 #endif
+#ifdef FFRS_CHECK_BOUNDS
+    m.attr("check_bounds") = true;
+#else
+    m.attr("check_bounds") = false;
+#endif
 
     m.def("create_buffer", &py_create_buffer, "size"_a, R"(
         Create a memory buffer of the specified size, backed by hugepages if possible.
@@ -120,11 +128,42 @@ PYBIND11_MODULE(libffrs, m) {
         The buffer is returned as a memoryview object that can be used in Python.
     )");
 
-    m.def("set_logger", [](py::object&& logger) { PyLogger::set_logger(logger); },
+    py::class_<workspace>(m, "Workspace", R"(
+        Scratch memory for ``encode`` and ``repair``, reused across calls instead of being
+        allocated by each one. It grows to the largest call using it and serves one call
+        at a time. Without one, each thread uses its own.
+    )")
+        .def(py::init<size_t>(), "size"_a = 0, R"(Reserve ``size`` bytes up front)")
+        .def_property_readonly("size", &workspace::size, R"(Bytes reserved)");
+
+    m.def("set_logger",[](py::object&& logger) { PyLogger::set_logger(logger); },
         "logger"_a, R"(
         Logger object to be used by C++ library or ``None`` to disable logging.
     )");
 
+    // detect CPU features once at import
+    SimdIsa::registry();
+
+    m.def("simd_isa", [] {
+        std::vector<std::tuple<std::string, size_t, bool>> res;
+        for (auto const& isa : SimdIsa::registry())
+            res.emplace_back(isa.name, isa.width, isa.supported);
+        return res;
+    }, R"(
+        Instruction sets compiled into the library as ``(name, width, supported)``, widest first.
+    )");
+
+    m.def("get_simd_isa", &SimdIsa::current, R"(
+        Widest instruction set enabled by default for new codecs.
+    )");
+
+    m.def("set_simd_isa", &SimdIsa::set, "name"_a, R"(
+        Limit the instruction set enabled by default for new codecs to ``name`` and narrower ones,
+        or ``None`` to use the widest one supported by the CPU. Existing codecs are not affected
+        and ``simd_x*`` arguments take precedence. ``avx2x2`` (16 lanes as two AVX2 vectors) is
+        only enabled by default when selected here.
+    )");
+
     m.doc() = R"(
         FFRS - Fairly Fast & Flexible Reed-Solomon coding
     )";
@@ -18,6 +18,12 @@
 
 #pragma once
 
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <vector>
 #include <pybind11/pybind11.h>
 
 
@@ -78,53 +84,89 @@ inline void _print_vec(const char *name, const Vec *const v, size_t len) {
 #endif
 
 
+/**
+ * Records logged by a thread that does not hold the GIL (e.g. inside ``without_gil``) are queued
+ * with their arguments captured by value and emitted by the next call that holds it.
+ */
 class PyLogger {
 private:
+    struct Record {
+        int level;
+        const char *file;
+        int lineno;
+        const char *msg;
+        const char *func;
+        std::function<py::tuple()> make_args;
+    };
+
     py::object _logger;
     py::object _log_handle;
     py::object _log_make_record;
-    bool _is_enabled_cache[5] = {false};
-    static inline PyLogger *_global_logger = nullptr;
+    std::atomic<bool> _is_enabled_cache[6] = {};
+    std::mutex _pending_mutex;
+    std::vector<Record> _pending;
+    static inline std::atomic<PyLogger *> _global_logger = nullptr;
 
     inline void _set_logger(py::object logger) {
         py::gil_scoped_acquire acquire;
+        _flush();
+
+        if (logger.is_none()) {
+            for (auto& is_enabled : _is_enabled_cache)
+                is_enabled = false;
+            _logger = _log_make_record = _log_handle = py::none();
+            return;
+        }
+
         _logger = logger;
         _log_make_record = _logger.attr("makeRecord");
         _log_handle = _logger.attr("handle");
 
         auto is_enabled_for = _logger.attr("isEnabledFor");
-        for (int i = 0; i < 5; ++i) {
+        for (int i = 0; i < 6; ++i) {
             auto is_enabled = is_enabled_for(i * 10);
             _is_enabled_cache[i] = is_enabled.cast<bool>();
         }
     }
 
-public:
-    PyLogger() {
-        py::gil_scoped_acquire acquire;
-        auto logging = py::module::import("logging");
-        _set_logger(logging.attr("getLogger")());
+    inline void _emit(int level, const char *file, int lineno, const char *msg, py::tuple&& args, const char *func) {
+        if (_log_handle.is_none())
+            return;
+
+        _log_handle(_log_make_record("par.rs", level, file, lineno, msg, args, py::none(), func));
+    }
 
-        py_assert(!_global_logger, "A global logger already exists");
-        _global_logger = this;
+    // requires the GIL
+    inline void _flush() {
+        std::vector<Record> pending;
+        {
+            std::lock_guard lock(_pending_mutex);
+            pending.swap(_pending);
+        }
+
+        for (auto& rec : pending)
+            _emit(rec.level, rec.file, rec.lineno, rec.msg, rec.make_args(), rec.func);
     }
 
-    ~PyLogger() {
+public:
+    PyLogger() {
         py::gil_scoped_acquire acquire;
-        _global_logger = nullptr;
+        _logger = _log_make_record = _log_handle = py::none();
     }
 
+    /**
+     * ``None`` disables logging but keeps the instance alive, since threads running without
+     * the GIL may still hold a pointer to it.
+     */
     static inline void set_logger(py::object logger) {
-        if (logger.is_none()) {
-            delete _global_logger;
-            _global_logger = nullptr;
-            return;
-        }
+        if (_global_logger == nullptr) {
+            if (logger.is_none())
+                return;
 
-        if (_global_logger == nullptr)
-            new PyLogger();
+            _global_logger = new PyLogger();
+        }
 
-        _global_logger->_set_logger(logger);
+        _global_logger.load()->_set_logger(logger);
     }
 
     inline py::object get_logger() const {
@@ -132,22 +174,66 @@ public:
         return _logger;
     }
 
-    inline void pylog(int level, const char *file, int lineno, const char *msg, py::tuple&& args, const char *func) {
-        if (!_is_enabled_cache[level / 10])
+    inline bool is_enabled_for(int level) const {
+        return _is_enabled_cache[level / 10].load(std::memory_order_relaxed);
+    }
+
+    template<typename...Args>
+    inline void pylog(int level, const char *file, int lineno, const char *msg, const char *func, Args&&...args) {
+        if (!is_enabled_for(level))
             return;
 
-        _log_handle(_log_make_record("par.rs", level, file, lineno, msg, args, py::none(), func));
+        if (PyGILState_Check()) {
+            _flush();
+            _emit(level, file, lineno, msg, py::make_tuple(std::forward<Args>(args)...), func);
+        } else {
+            std::lock_guard lock(_pending_mutex);
+            _pending.push_back({level, file, lineno, msg, func,
+                [...args = std::decay_t<Args>(std::forward<Args>(args))] { return py::make_tuple(args...); }});
+        }
+    }
+
+    // emit records queued while the GIL was released, requires the GIL
+    static inline void flush() {
+        if (auto logger = instance())
+            logger->_flush();
     }
 
     static inline PyLogger *instance() {
-        return _global_logger;
+        return _global_logger.load(std::memory_order_acquire);
     }
 };
 
 
-#define _pylog(level, msg, ...) if (PyLogger::instance()) PyLogger::instance()->pylog(level, __FILE__, __LINE__, msg, py::make_tuple(__VA_ARGS__), __FUNCTION__)
+#define _pylog(level, msg, ...) if (auto _logger = PyLogger::instance(); _logger && _logger->is_enabled_for(level)) _logger->pylog(level, __FILE__, __LINE__, msg, __FUNCTION__ __VA_OPT__(,) __VA_ARGS__)
 #define log_critical(msg, ...) _pylog(50, msg, __VA_ARGS__)
 #define log_error(msg, ...) _pylog(40, msg, __VA_ARGS__)
 #define log_warning(msg, ...) _pylog(30, msg, __VA_ARGS__)
 #define log_info(msg, ...) _pylog(20, msg, __VA_ARGS__)
 #define log_debug(msg, ...) _pylog(10, msg, __VA_ARGS__)
+
+
+/**
+ * Run ``f`` with the GIL released. Buffers passed in must stay exported (``buffer_ro``/``buffer_rw``)
+ * and ``f`` must not touch Python objects. Log records queued meanwhile are emitted afterwards.
+ */
+template<typename F>
+inline auto without_gil(F&& f) {
+    using Result = std::invoke_result_t<F>;
+
+    if constexpr (std::is_void_v<Result>) {
+        {
+            py::gil_scoped_release release;
+            f();
+        }
+        PyLogger::flush();
+    } else {
+        std::optional<Result> res;
+        {
+            py::gil_scoped_release release;
+            res.emplace(f());
+        }
+        PyLogger::flush();
+        return std::move(*res);
+    }
+}
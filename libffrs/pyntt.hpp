@@ -44,6 +44,10 @@ inline void NTT::register_class(py::module &m) {
         .def_property_readonly("block_len", [](NTT& self) { return self.block_len; })
         .def_property_readonly("ecc_len", [](NTT& self) { return self.ecc_len; })
         .def_property_readonly("ecc_size", [](NTT& self) { return self.ecc_len * sizeof(uint16_t); })
+        .def_property_static("cache_budget",
+            py::cpp_function([](py::object) { return NTT::cache_budget.load(std::memory_order_relaxed); }),
+            py::cpp_function([](py::object, size_t budget) { NTT::cache_budget.store(budget, std::memory_order_relaxed); }),
+            R"(Transforms larger than this many bytes use the cache-blocked (four-step) schedule)")
 
         .def("rbo", &NTT::rbo, R"(Reverse Bit Order for :math:`\log_2 \text{ntt_len}` bits)", "i"_a)
 
@@ -96,37 +96,22 @@ public:
         this->message_len = block_len - ecc_len;
     }
 
-    inline py::bytearray py_encode(buffer_ro<uint8_t> buf) {
-        size_t message_len = block_len - ecc_len;
-
-        if (buf.size == 0 || block_len == 0 || block_len <= ecc_len)
-            return {};
-
-        size_t full_blocks = buf.size / message_len;
-        size_t output_size = full_blocks * ecc_len;
-
-        // Last block will be smaller if input size is not divisible by message_len
-        size_t input_remainder = buf.size - full_blocks * message_len;
-        if (input_remainder > 0)
-            output_size += ecc_len;
-
-        auto output = py::bytearray();
-        PyByteArray_Resize(output.ptr(), output_size);
-        assert(size_t(PyByteArray_Size(output.ptr())) == output_size);
-        auto output_data = reinterpret_cast<uint8_t *>(PyByteArray_AsString(output.ptr()));
-
-        for (size_t block = 0; block < full_blocks; ++block) {
-            encode(&buf.data[block * message_len], message_len, &output_data[block * ecc_len]);
-        }
+    inline py::object py_encode(buffer_ro<uint8_t> buf, bool reuse_output) {
+        auto [output, output_data] = output_buffer(_encoded_size(buf.size), reuse_output ? &_output : nullptr);
+        _encode_blocks(&buf.data[0], buf.size, reinterpret_cast<uint8_t *>(output_data));
+        return output;
+    }
 
-        if (input_remainder > 0) {
-            encode(&buf.data[buf.size - input_remainder], input_remainder, &output_data[full_blocks * ecc_len]);
-        }
+    inline size_t py_encode_into(buffer_ro<uint8_t> buf, buffer_out<uint8_t> ecc_out) {
+        size_t output_size = _encoded_size(buf.size);
+        py_assert(ecc_out.size >= output_size, std::to_string(ecc_out.size) + " < " + std::to_string(output_size));
 
-        return output;
+        _encode_blocks(&buf.data[0], buf.size, &ecc_out.data[0]);
+        return output_size;
     }
 
     inline bool py_repair(buffer_rw<uint8_t> buf, buffer_rw<uint8_t> ecc) {
+        py::gil_scoped_release release;
         return decode(&buf.data[0], message_len, &ecc.data[0]);
     }
 
@@ -177,8 +162,12 @@ public:
             .def("__sizeof_cpp__", [](PyRS256& self) { return sizeof(self); })
 
             .def("encode", cast_args(&PyRS256::py_encode),
-                R"(Encode message, return ecc)",
-                "buffer"_a)
+                R"(Encode message, return ecc. With reuse_output, return a memoryview into a codec-owned buffer, overwritten by the next such call from the same thread)",
+                "buffer"_a, py::kw_only(), "reuse_output"_a = false)
+
+            .def("encode_into", cast_args(&PyRS256::py_encode_into),
+                R"(Encode message into the writable buffer ecc_out, which must not overlap buffer. Return the number of bytes written)",
+                "buffer"_a, "ecc_out"_a)
 
             .def("repair", cast_args(&PyRS256::py_repair),
                 R"(Repair message + ecc)",
@@ -192,6 +181,37 @@ public:
     }
 
 private:
+    // storage for encode(reuse_output=True)
+    reusable_output _output;
+
+    /**
+     * ECC size for a message of `size` bytes, the last block is smaller if size is not divisible by message_len
+     */
+    inline size_t _encoded_size(size_t size) const {
+        if (size == 0 || block_len == 0 || block_len <= ecc_len)
+            return 0;
+
+        return (size + message_len - 1) / message_len * ecc_len;
+    }
+
+    inline void _encode_blocks(const uint8_t src[], size_t size, uint8_t dst[]) {
+        if (_encoded_size(size) == 0)
+            return;
+
+        size_t full_blocks = size / message_len;
+        size_t input_remainder = size - full_blocks * message_len;
+
+        py::gil_scoped_release release;
+
+        for (size_t block = 0; block < full_blocks; ++block) {
+            encode(&src[block * message_len], message_len, &dst[block * ecc_len]);
+        }
+
+        if (input_remainder > 0) {
+            encode(&src[size - input_remainder], input_remainder, &dst[full_blocks * ecc_len]);
+        }
+    }
+
     inline uint8_t _get_ecc_len(
             std::optional<uint8_t> block_len,
             std::optional<uint8_t> message_len,
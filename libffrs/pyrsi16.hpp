@@ -18,7 +18,15 @@
 
 # pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <limits>
+#include <memory>
 #include <optional>
+#include <string>
+#include <tuple>
+#include <type_traits>
 
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
@@ -26,11 +34,171 @@
 #include "util.hpp"
 // #include "rsi16v_impl.hpp"
 #include "rsi16v.hpp"
+#include "pylogging.hpp"
 #include "pyntt.hpp"
 
 namespace py = pybind11;
 
 
+/**
+ * Vector instruction sets the RSi16v kernels are compiled for, widest first.
+ * Each width is built in its own translation unit (rsi16v_*.cpp), `supported`
+ * is detected once when the module is loaded. "avx2x2" runs 16 lanes as two
+ * AVX2 vectors on CPUs without AVX-512, and `layout` holds the uint16_t
+ * conversion kernels of each instruction set.
+ */
+struct SimdIsa {
+    const char *name;
+    size_t width;
+    bool supported;
+    vec::layout_kernels const *layout;
+    // only enabled by default when selected by `set_simd_isa`
+    bool opt_in;
+
+    static inline std::array<SimdIsa, 5> const& registry() {
+        static const std::array<SimdIsa, 5> isa = [] {
+            __builtin_cpu_init();
+            return std::array<SimdIsa, 5>{{
+                {"avx512f", 16, bool(__builtin_cpu_supports("avx512f")), &vec::layout_avx512f, false},
+                // no faster per lane than avx2 alone
+                {"avx2x2",  16, bool(__builtin_cpu_supports("avx2")),    &vec::layout_avx2x2,  true},
+                {"avx2",    8,  bool(__builtin_cpu_supports("avx2")),    &vec::layout_avx2,    false},
+                {"sse2",    4,  bool(__builtin_cpu_supports("sse2")),    &vec::layout_sse2,    false},
+                {"scalar",  1,  true,                                    &vec::layout_scalar,  false},
+            }};
+        }();
+        return isa;
+    }
+
+    // First entry of `registry()` enabled by default for new codecs, raised by `set_simd_isa`
+    static inline size_t& selected() {
+        static size_t first = 0;
+        return first;
+    }
+
+    /**
+     * First supported entry for `width` lanes from index `first` on. By default, opt-in
+     * entries are skipped unless `first` is theirs.
+     */
+    static inline SimdIsa const *find(size_t width, size_t first = 0, bool by_default = false) {
+        auto const& isa = registry();
+        for (size_t i = first; i < isa.size(); ++i) {
+            if (by_default && isa[i].opt_in && i != first)
+                continue;
+            if (isa[i].width == width && isa[i].supported)
+                return &isa[i];
+        }
+        return nullptr;
+    }
+
+    static inline bool available(size_t width) {
+        return find(width) != nullptr;
+    }
+
+    static inline bool enabled(size_t width) {
+        return find(width, selected(), true) != nullptr;
+    }
+
+    // Whether new codecs run 16 lanes as two AVX2 vectors
+    static inline bool x16_avx2() {
+        auto isa = find(16, selected(), true);
+        if (!isa)
+            isa = find(16);
+        return isa && isa->layout == &vec::layout_avx2x2;
+    }
+
+    static inline void set(std::optional<std::string> const& name) {
+        if (!name) {
+            selected() = 0;
+            return;
+        }
+
+        auto const& isa = registry();
+        for (size_t i = 0; i < isa.size(); ++i) {
+            if (*name == isa[i].name) {
+                if (!isa[i].supported)
+                    throw py::value_error("instruction set not supported by this CPU: " + *name);
+                selected() = i;
+                return;
+            }
+        }
+        throw py::value_error("unknown instruction set: " + *name);
+    }
+
+    /**
+     * Lanes of the RSi16e encoder within the `set_simd_isa` limit: 32 with AVX-512BW,
+     * 16 with AVX2, 0 without either
+     */
+    static inline size_t epi16_width() {
+        static const bool avx512bw = __builtin_cpu_supports("avx512bw");
+        if (selected() == 0 && registry()[0].supported && avx512bw)
+            return 32;
+        return find(8, selected()) ? 16 : 0;
+    }
+
+    static inline std::string current() {
+        auto const& isa = registry();
+        for (size_t i = selected(); i < isa.size(); ++i)
+            if (isa[i].supported && (!isa[i].opt_in || i == selected()))
+                return isa[i].name;
+        return "scalar";
+    }
+};
+
+
+/**
+ * Tables of a codec configuration: field, NTT and the encoder/decoder instances.
+ * Immutable, shared between all codecs with the same (primitive, block_len, ecc_len).
+ */
+struct RSi16Plan {
+    // plans kept alive without codecs, see shared_cache
+    static constexpr size_t recent_plans = 4;
+
+    // sequence number of the plan, for tests and debugging
+    const size_t id;
+    const std::shared_ptr<const PyGFi16> gf;
+    const NTT ntt;
+    const RSi16v<1> rs16;
+    const RSi16v<4> rs16x4;
+    const RSi16v<8> rs16x8;
+    const RSi16v<16> rs16x16;
+    const RSi16v<16, GFTx8x2> rs16x8x2;
+    const RSi16e<16> rs16e16;
+    const RSi16e<32> rs16e32;
+
+    inline RSi16Plan(std::shared_ptr<const PyGFi16> gf, size_t block_len, size_t ecc_len):
+        id(_next_id()),
+        gf(std::move(gf)),
+        ntt(*this->gf, block_len, ecc_len),
+        rs16(ntt, block_len, ecc_len, vec::layout_scalar),
+        rs16x4(ntt, block_len, ecc_len, vec::layout_sse2),
+        rs16x8(ntt, block_len, ecc_len, vec::layout_avx2),
+        rs16x16(ntt, block_len, ecc_len, vec::layout_avx512f),
+        rs16x8x2(ntt, block_len, ecc_len, vec::layout_avx2x2),
+        rs16e16(ntt, rs16._ecc_mix),
+        rs16e32(ntt, rs16._ecc_mix)
+    { }
+
+    static inline std::shared_ptr<const PyGFi16> get_gf(GFT primitive) {
+        static shared_cache<GFT, PyGFi16> cache;
+        return cache.get(primitive, [&] { return std::make_shared<const PyGFi16>(primitive); });
+    }
+
+    static inline std::shared_ptr<const RSi16Plan> get(GFT primitive, size_t block_len, size_t ecc_len) {
+        static shared_cache<std::tuple<GFT, size_t, size_t>, RSi16Plan, recent_plans> cache;
+        return cache.get({primitive, block_len, ecc_len}, [&] {
+            return std::make_shared<const RSi16Plan>(get_gf(primitive), block_len, ecc_len);
+        });
+    }
+
+private:
+    static inline size_t _next_id() {
+        static std::atomic<size_t> next = 0;
+        return next.fetch_add(1, std::memory_order_relaxed);
+    }
+};
+
+
 class PyRSi16 {
 private:
     struct rs_data {
@@ -44,17 +212,25 @@ private:
         GFT primitive,
         bool simd_x4,
         bool simd_x8,
-        bool simd_x16
+        bool simd_x16,
+        bool simd_x16_avx2,
+        size_t simd_epi16,
+        size_t threads
     ):
-        gf(primitive),
-        ntt(gf, args.block_len, args.ecc_len),
-        rs16(ntt, args.block_len, args.ecc_len),
-        rs16x4(ntt, args.block_len, args.ecc_len),
-        rs16x8(ntt, args.block_len, args.ecc_len),
-        rs16x16(ntt, args.block_len, args.ecc_len),
+        plan(RSi16Plan::get(primitive, args.block_len, args.ecc_len)),
+        gf(*plan->gf),
+        ntt(plan->ntt),
+        rs16(plan->rs16),
+        rs16x4(plan->rs16x4),
+        rs16x8(plan->rs16x8),
+        rs16x16(plan->rs16x16),
+        rs16x8x2(plan->rs16x8x2),
         simd_x4(simd_x4),
         simd_x8(simd_x8),
         simd_x16(simd_x16),
+        simd_x16_avx2(simd_x16_avx2),
+        simd_epi16(simd_epi16),
+        threads(resolve_threads(threads)),
         block_len(args.block_len),
         message_len(args.block_len - args.ecc_len),
         ecc_len(args.ecc_len),
@@ -62,7 +238,7 @@ private:
         interleaved_block_len(block_len * interleave),
         interleaved_message_len(message_len * interleave),
         interleaved_ecc_len(ecc_len * interleave),
-        repair_temp_len(ntt.ntt_len + ecc_len * 6)
+        repair_temp_len(ecc_len * 8)
     {
         if (simd_x16)
             vec_align = 16 * sizeof(GFT);
@@ -85,15 +261,24 @@ private:
     }
 
 public:
-    const PyGFi16 gf;
-    const NTT ntt;
-    const RSi16v<1> rs16;
-    const RSi16v<4> rs16x4;
-    const RSi16v<8> rs16x8;
-    const RSi16v<16> rs16x16;
+    // shared tables, see RSi16Plan
+    const std::shared_ptr<const RSi16Plan> plan;
+    PyGFi16 const& gf;
+    NTT const& ntt;
+    RSi16v<1> const& rs16;
+    RSi16v<4> const& rs16x4;
+    RSi16v<8> const& rs16x8;
+    RSi16v<16> const& rs16x16;
+    RSi16v<16, GFTx8x2> const& rs16x8x2;
     bool simd_x4;
     bool simd_x8;
     bool simd_x16;
+    // 16 lanes as two AVX2 vectors instead of AVX-512
+    bool simd_x16_avx2;
+    // lanes of the 16-bit lane encoder used for interleaved encode, 0 if disabled
+    size_t simd_epi16;
+    // default encoder threads
+    size_t threads;
 
     const size_t block_len;
     const size_t message_len;
@@ -105,6 +290,17 @@ public:
     const size_t repair_temp_len;
     size_t vec_align;
 
+    // columns with more errors are scheduled as if they had ecc_len / 2
+    static constexpr size_t max_error_estimate = 16;
+
+    // message symbols encoded by each thread at least
+    static constexpr size_t min_thread_len = size_t(1) << 16;
+
+    // interleaved encode reads and writes whole cache lines of columns at a time
+    static constexpr size_t cache_line = 64;
+    // rows of the next tile prefetched ahead, matches the row prefetch distance of RSi16v::encode
+    static constexpr size_t prefetch_rows = 16;
+
     inline PyRSi16(
             size_t block_len,
             uint16_t ecc_len,
@@ -112,75 +308,171 @@ public:
             GFT primitive,
             std::optional<bool> simd_x4,
             std::optional<bool> simd_x8,
-            std::optional<bool> simd_x16
+            std::optional<bool> simd_x16,
+            size_t threads = 1,
+            bool simd_epi16 = false
     ):
         PyRSi16(
             rs_data(block_len, ecc_len),
             interleave,
             primitive,
-            simd_x4.value_or(__builtin_cpu_supports("sse2")),
-            simd_x8.value_or(__builtin_cpu_supports("avx2")),
-            simd_x16.value_or(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq"))
+            simd_x4.value_or(SimdIsa::enabled(4)),
+            simd_x8.value_or(SimdIsa::enabled(8)),
+            simd_x16.value_or(SimdIsa::enabled(16)),
+            SimdIsa::x16_avx2(),
+            simd_epi16 ? SimdIsa::epi16_width() : 0,
+            threads
         )
-    { }
+    {
+        if (simd_epi16 && this->simd_epi16 == 0)
+            throw py::value_error("16-bit lane encode needs AVX2 or AVX-512BW");
+
+        for (auto [width, requested] : {std::pair{4, simd_x4}, {8, simd_x8}, {16, simd_x16}}) {
+            if (requested.value_or(false) && !SimdIsa::available(width))
+                throw py::value_error("SIMD x" + std::to_string(width) + " not supported by this CPU");
+        }
+    }
 
     template<typename Src, typename Dst>
     inline void encode_blocks(const Src src[], size_t full_blocks, Dst dst[]) const {
-        _simd_dispatch([&]<size_t SIMD_W>(std::integral_constant<size_t, SIMD_W>, auto& rs) {
-            auto temp = new_aligned<GFT>(block_len * SIMD_W, SIMD_W * sizeof(GFT));
-
-            size_t block = 0;
-            for (; full_blocks - block >= SIMD_W; block += SIMD_W)
-                encode_block<SIMD_W>(rs, &src[block * message_len], &temp[0], &dst[block * ecc_len]);
+        encode_blocks(&src[0], full_blocks, &dst[0], threads);
+    }
 
-            auto remainder = (full_blocks - block) * message_len;
-            if (remainder)
-                encode_block<SIMD_W>(rs, &src[block * message_len], remainder, &temp[0], &dst[block * ecc_len]);
+    /**
+     * Groups of SIMD_W blocks are split between threads
+     */
+    template<typename Src, typename Dst>
+    inline void encode_blocks(const Src src[], size_t full_blocks, Dst dst[], size_t threads) const {
+        _simd_dispatch([&]<size_t SIMD_W>(std::integral_constant<size_t, SIMD_W>, auto& rs) {
+            size_t groups = (full_blocks + SIMD_W - 1) / SIMD_W;
+            size_t tasks = _thread_count(threads, full_blocks * message_len, groups);
+            // workers don't see the caller's workspace, each task takes its slice of this
+            size_t stride = _task_scratch_len<SIMD_W>();
+            auto scratch = workspace::current().alloc<GFT>(tasks * stride, cache_line);
+
+            parallel_for(tasks, tasks, [&](size_t task) {
+                auto temp = &scratch[task * stride];
+
+                size_t first = groups * task / tasks * SIMD_W;
+                size_t last = std::min(groups * (task + 1) / tasks * SIMD_W, full_blocks);
+                for (size_t block = first; block < last; block += SIMD_W) {
+                    size_t cols = std::min(SIMD_W, full_blocks - block);
+                    rs.encode(&src[block * message_len], 1, message_len, cols, &temp[0], &temp[ecc_len * SIMD_W]);
+                    vec::store_transposed<SIMD_W>(rs.layout, &temp[0], &dst[block * ecc_len], ecc_len, ecc_len, cols);
+                }
+            });
         });
     }
 
     template<typename Src, typename Dst>
     inline void encode_interleaved_blocks(const Src src[], size_t full_blocks, Dst dst[]) const {
+        encode_interleaved_blocks(&src[0], full_blocks, &dst[0], threads);
+    }
+
+    /**
+     * Streams through `full_blocks` interleaved blocks in tiles of columns spanning whole cache
+     * lines. Consecutive (block, tile) pairs are split between threads, and the head of the next
+     * tile is prefetched while the current one is encoded.
+     */
+    template<typename Src, typename Dst>
+    inline void encode_interleaved_blocks(const Src src[], size_t full_blocks, Dst dst[], size_t threads) const {
+        if constexpr (std::is_same_v<Src, uint16_t> && std::is_same_v<Dst, uint16_t>) {
+            if (simd_epi16 == 32)
+                return _encode_interleaved_epi16(plan->rs16e32, src, full_blocks, dst, threads);
+            if (simd_epi16 == 16)
+                return _encode_interleaved_epi16(plan->rs16e16, src, full_blocks, dst, threads);
+        }
+
         _simd_dispatch([&]<size_t SIMD_W>(std::integral_constant<size_t, SIMD_W>, auto& rs) {
-            // TODO: handle case when interleave is not a multiple of SIMD_W
-            auto temp = new_aligned<GFT>(block_len * SIMD_W, SIMD_W * sizeof(GFT));
-            for (size_t block = 0; block < full_blocks; ++block)
-                _encode_interleaved<SIMD_W>(rs, &src[0], &temp[0], &dst[0]);
+            constexpr size_t tile_cols = std::max(SIMD_W, cache_line / sizeof(Src));
+            size_t tiles = (interleave + tile_cols - 1) / tile_cols;
+            size_t count = full_blocks * tiles;
+            size_t tasks = _thread_count(threads, full_blocks * interleaved_message_len, count);
+            size_t stride = _task_scratch_len<SIMD_W>();
+            auto scratch = workspace::current().alloc<GFT>(tasks * stride, cache_line);
+
+            parallel_for(tasks, tasks, [&](size_t task) {
+                auto temp = &scratch[task * stride];
+
+                size_t last = count * (task + 1) / tasks;
+                for (size_t i = count * task / tasks; i < last; ++i) {
+                    size_t block = i / tiles;
+                    size_t col = i % tiles * tile_cols;
+
+                    if (i + 1 < last) {
+                        auto next = &src[(i + 1) / tiles * interleaved_message_len + (i + 1) % tiles * tile_cols];
+                        for (size_t r = 0; r < std::min(prefetch_rows, message_len); ++r)
+                            __builtin_prefetch(&next[r * interleave]);
+                    }
+
+                    _encode_interleaved<SIMD_W>(rs, &src[block * interleaved_message_len], &temp[0],
+                        &dst[block * interleaved_ecc_len], col, std::min(col + tile_cols, interleave));
+                }
+            });
         });
     }
 
     template<typename Src, typename Dst>
     inline void encode_interleaved(const Src src[], Dst dst[]) const {
-        _simd_dispatch([&]<size_t SIMD_W>(std::integral_constant<size_t, SIMD_W>, auto& rs) {
-            auto temp = new_aligned<GFT>(block_len * SIMD_W, SIMD_W * sizeof(GFT));
-            _encode_interleaved<SIMD_W>(rs, &src[0], &temp[0], &dst[0]);
-        });
+        encode_interleaved_blocks(&src[0], 1, &dst[0], threads);
     }
 
     template<typename Msg, typename Ecc>
     inline RepairStatus repair_interleaved(Msg message[], Ecc ecc[], size_t col_start, size_t col_count) const {
-        return _simd_dispatch([&]<size_t SIMD_W>(std::integral_constant<size_t, SIMD_W>, auto& rs) {
-            return _repair_interleaved<SIMD_W>(rs, &message[0], &ecc[0], col_start, col_count);
-        });
+        message += col_start;
+        ecc += col_start;
+
+        // clean columns need no repair
+        auto synds = workspace::current().alloc<GFT>(col_count * ecc_len, vec_align);
+        synd_interleaved(&message[0], &ecc[0], col_count, &synds[0]);
+
+        // (estimated errors, column), sorted so that lanes in a vector finish
+        // together. Only light columns are counted exactly, the heavy ones
+        // are grouped together regardless of their error count.
+        std::vector<std::pair<size_t, size_t>> cols;
+        for (size_t col = 0; col < col_count; ++col) {
+            auto col_synds = &synds[col * ecc_len];
+            if (std::any_of(&col_synds[0], &col_synds[ecc_len], [](auto v) { return v != 0; }))
+                cols.emplace_back(_error_count(&col_synds[0], max_error_estimate), col);
+        }
+        std::sort(cols.begin(), cols.end());
+
+        RepairStatus res = RepairStatus::NoErrors;
+        for (auto [width, first, count] : _lane_schedule(cols)) {
+            res = std::max(res, _simd_dispatch(width, [&]<size_t SIMD_W>(std::integral_constant<size_t, SIMD_W>, auto& rs) {
+                return _repair_columns<SIMD_W>(rs, &message[0], &ecc[0], &synds[0], &cols[first], count);
+            }));
+        }
+        return res;
     }
 
+    /**
+     * error_pos: known error locations, shared by all columns.
+     * unknown_errors: also correct errors at other locations
+     * (errors-and-erasures decoding)
+     */
     template<typename Msg, typename Ecc>
-    inline RepairStatus repair_interleaved(Msg message[], Ecc ecc[], size_t col_start, size_t col_count, std::vector<size_t> const& error_pos) const {
-        auto error_pos_rbo = std::vector<size_t>(error_pos.size());
-        for (size_t i = 0; i < error_pos.size(); ++i)
-            error_pos_rbo[i] = ntt.rbo(error_pos[i]);
+    inline RepairStatus repair_interleaved(Msg message[], Ecc ecc[], size_t col_start, size_t col_count, std::vector<size_t> const& error_pos, bool unknown_errors = false) const {
+        return repair_interleaved(&message[0], &ecc[0], col_start, col_count, ErasurePlan(ntt, error_pos), unknown_errors);
+    }
 
+    /**
+     * plan: known error locations shared by all columns, can be reused
+     * between calls with the same locations
+     */
+    template<typename Msg, typename Ecc>
+    inline RepairStatus repair_interleaved(Msg message[], Ecc ecc[], size_t col_start, size_t col_count, ErasurePlan const& plan, bool unknown_errors = false) const {
         return _simd_dispatch([&]<size_t SIMD_W>(std::integral_constant<size_t, SIMD_W>, auto& rs) {
-            return _repair_interleaved<SIMD_W>(rs, &message[0], &ecc[0], col_start, col_count, error_pos_rbo);
+            return _repair_interleaved<SIMD_W>(rs, &message[0], &ecc[0], col_start, col_count, plan, unknown_errors);
         });
     }
 
-    inline void repair_block(GFT block[], std::vector<size_t> const& error_pos, GFT temp_ntt1_ecc6[]) const {
+    inline void repair_block(GFT block[], std::vector<size_t> const& error_pos, GFT temp_ecc6[]) const {
         auto error_pos_rbo = std::vector<size_t>(error_pos.size());
         for (size_t i = 0; i < error_pos.size(); ++i)
             error_pos_rbo[i] = ntt.rbo(error_pos[i]);
 
-        rs16.repair(&block[0], &error_pos_rbo[0], error_pos_rbo.size(), &temp_ntt1_ecc6[0]);
+        rs16.repair(&block[0], &error_pos_rbo[0], error_pos_rbo.size(), &temp_ecc6[0]);
     }
 
     inline void synd_block(GFT block[]) const {
@@ -188,31 +480,40 @@ public:
     }
 
     template<typename Msg, typename Ecc>
-    inline void synd_blocks(const Msg msg[], const Ecc ecc[], size_t count, GFT temp[], GFT synds[]) const {
-        // len(temp) == block_len
+    inline void synd_blocks(const Msg msg[], const Ecc ecc[], size_t count, GFT synds[]) const {
         // len(synds) == count * ecc_len
-        for (size_t i = 0; i < count; ++i) {
-            std::copy_n(&msg[i * message_len], message_len, &temp[0]);
-            std::copy_n(&ecc[i * ecc_len], ecc_len, &temp[message_len]);
-            ntt.pntt(&temp[0]);
-            std::copy_n(&temp[0], ecc_len, &synds[i * ecc_len]);
-        }
+        _simd_dispatch([&]<size_t SIMD_W>(std::integral_constant<size_t, SIMD_W>, auto& rs) {
+            auto temp = workspace::current().alloc<GFT>(block_len * SIMD_W, SIMD_W * sizeof(GFT));
+            for (size_t i = 0; i < count; i += SIMD_W) {
+                size_t cols = std::min(SIMD_W, count - i);
+                if (cols < SIMD_W)
+                    std::fill_n(&temp[0], block_len * SIMD_W, 0);
+
+                vec::load_transposed<SIMD_W>(rs.layout, &msg[i * message_len], message_len, &temp[0], message_len, cols);
+                vec::load_transposed<SIMD_W>(rs.layout, &ecc[i * ecc_len], ecc_len, &temp[message_len * SIMD_W], ecc_len, cols);
+                rs.synd(&temp[0]);
+                vec::store_transposed<SIMD_W>(rs.layout, &temp[0], &synds[i * ecc_len], ecc_len, ecc_len, cols);
+            }
+        });
     }
 
-    inline void synd_interleaved(const uint16_t msg[], const uint16_t ecc[], GFT temp[], GFT synds[]) {
-        // len(temp) == block_len
-        // len(synds) == count * ecc_len
-
-        const size_t SIMD_W = 1;
-        for (size_t i = 0; i < interleave; ++i) {
-            // std::copy_n(&msg[i * message_len], message_len, &temp[0]);
-            vec::copy_stride(&msg[i * SIMD_W], interleave, &temp[0], SIMD_W, SIMD_W, message_len);
-            // std::copy_n(&ecc[i * ecc_len], ecc_len, &temp[message_len]);
-            vec::copy_transposed(&ecc[i * ecc_len], ecc_len, &temp[message_len * SIMD_W], SIMD_W);
-            ntt.pntt(&temp[0]);
-            // std::copy_n(&temp[0], ecc_len, &synds[i * ecc_len]);
-            vec::copy_transposed(&temp[0], SIMD_W, &synds[i * ecc_len * SIMD_W], ecc_len);
-        }
+    template<typename Msg, typename Ecc>
+    inline void synd_interleaved(const Msg msg[], const Ecc ecc[], size_t col_count, GFT synds[]) const {
+        // len(synds) == col_count * ecc_len
+        _simd_dispatch([&]<size_t SIMD_W>(std::integral_constant<size_t, SIMD_W>, auto& rs) {
+            auto temp = workspace::current().alloc<GFT>(block_len * SIMD_W, SIMD_W * sizeof(GFT));
+            for (size_t i = 0; i < col_count; i += SIMD_W) {
+                size_t cols = std::min(SIMD_W, col_count - i);
+                if (cols < SIMD_W)
+                    std::fill_n(&temp[0], block_len * SIMD_W, 0);
+
+                // Interleaved ecc
+                vec::load_stride<SIMD_W>(rs.layout, &msg[i], interleave, &temp[0], message_len, cols);
+                vec::load_stride<SIMD_W>(rs.layout, &ecc[i], interleave, &temp[message_len * SIMD_W], ecc_len, cols);
+                rs.synd(&temp[0]);
+                vec::store_transposed<SIMD_W>(rs.layout, &temp[0], &synds[i * ecc_len], ecc_len, ecc_len, cols);
+            }
+        });
     }
 
     inline void mix_ecc(GFT ecc[]) const {
@@ -261,10 +562,14 @@ public:
             .def_property_readonly("gf", [](PyRSi16& self) -> auto const * { return &self.gf; }, R"(:class:`GFi16` instance for :math:`GF(65537)`)")
             .def_property_readonly("ntt", [](PyRSi16& self) -> auto const * { return &self.ntt; }, R"(:class:`NTT` instance)")
             .def_property_readonly("interleave", [](PyRSi16& self) { return self.interleave; }, R"(Number of interleaved columns)")
+            .def_property_readonly("_plan_id", [](PyRSi16& self) { return self.plan->id; }, R"(Sequence number of the shared tables of the codec, equal for codecs sharing them)")
 
             .def_property_readonly("simd_x4", [](PyRSi16& self) { return self.simd_x4; }, R"(SIMD x4 encoding enabled (SSE2))")
             .def_property_readonly("simd_x8", [](PyRSi16& self) { return self.simd_x8; }, R"(SIMD x8 encoding enabled (AVX2))")
-            .def_property_readonly("simd_x16", [](PyRSi16& self) { return self.simd_x16; }, R"(SIMD x16 encoding enabled (AVX512))")
+            .def_property_readonly("simd_x16", [](PyRSi16& self) { return self.simd_x16; }, R"(SIMD x16 encoding enabled (AVX-512F, or two AVX2 vectors))")
+            .def_property_readonly("simd_x16_avx2", [](PyRSi16& self) { return self.simd_x16_avx2; }, R"(SIMD x16 runs as two AVX2 vectors instead of AVX-512F)")
+            .def_property_readonly("simd_epi16", [](PyRSi16& self) { return self.simd_epi16; }, R"(Lanes of the 16-bit lane interleaved encoder (AVX2: 16, AVX-512BW: 32), 0 if disabled)")
+            .def_property_readonly("threads", [](PyRSi16& self) { return self.threads; }, R"(Default number of encoder threads)")
 
             .def(py::init<
                     size_t,    // block_len
@@ -273,9 +578,11 @@ public:
                     GFT,  // primitive
                     std::optional<bool>,
                     std::optional<bool>,
-                    std::optional<bool>
+                    std::optional<bool>,
+                    size_t,    // threads
+                    bool       // simd_epi16
                 >(),
-                R"(Instantiate a Reed-Solomon encoder with the given configuration)",
+                R"(Instantiate a Reed-Solomon encoder with the given configuration. simd_epi16: interleaved encode in 16-bit lanes, faster than 32-bit lanes only with AVX-512BW and small ecc_len)",
                 "block_len"_a,
                 "ecc_len"_a,
                 "interleave"_a = 1,
@@ -283,26 +590,49 @@ public:
                 "primitive"_a = 3,
                 "simd_x4"_a = py::none(),
                 "simd_x8"_a = py::none(),
-                "simd_x16"_a = py::none()
+                "simd_x16"_a = py::none(),
+                "threads"_a = 1,
+                "simd_epi16"_a = false
             )
 
             .def("__sizeof_cpp__", [](PyRSi16& self) { return sizeof(self); })
 
             .def("encode", cast_args(&PyRSi16::py_encode),
-                R"(Systematic encode)",
-                "buffer"_a)
+                R"(Systematic encode. threads: overrides the codec default, 0 for one per hardware thread. With reuse_output, return a memoryview into a codec-owned buffer, overwritten by the next such call from the same thread)",
+                "buffer"_a,
+                py::kw_only(),
+                "threads"_a = py::none(),
+                "reuse_output"_a = false,
+                "workspace"_a = py::none())
+
+            .def("encode_into", cast_args(&PyRSi16::py_encode_into),
+                R"(Systematic encode into the writable buffer ecc_out, which must not overlap buffer. Return the number of bytes written)",
+                "buffer"_a,
+                "ecc_out"_a,
+                py::kw_only(),
+                "threads"_a = py::none(),
+                "workspace"_a = py::none())
 
             .def("repair", cast_args(&PyRSi16::py_repair),
-                R"(Repair a block with the given error locations)",
+                R"(Repair a block with the given error locations. With unknown_errors, errors at other locations are also corrected)",
                 "message"_a,
                 "ecc"_a,
-                "error_pos"_a = py::none())
+                "error_pos"_a = py::none(),
+                "unknown_errors"_a = false,
+                py::kw_only(),
+                "workspace"_a = py::none())
 
             .def("_synd", cast_args(&PyRSi16::py_synd),
                 R"(Calculate syndromes for the given message and ecc buffers)",
                 "message"_a,
                 "ecc"_a)
 
+            .def("_repair_ntt", cast_args(&PyRSi16::py_repair_ntt),
+                R"(Repair a block with the given error locations through the full NTT, or evaluating at the error locations for large error counts)",
+                "message"_a,
+                "ecc"_a,
+                "error_pos"_a)
+
             .def("_sugiyama", &PyRSi16::py_sugiyama<1>, R"(Compute error locator and evaluator polynomials)", "synd"_a)
             .def("_sugiyama4", &PyRSi16::py_sugiyama<4>, R"(Compute error locator and evaluator polynomials)", "synd"_a)
             .def("_sugiyama8", &PyRSi16::py_sugiyama<8>, R"(Compute error locator and evaluator polynomials)", "synd"_a)
@@ -320,149 +650,242 @@ public:
     }
 
 private:
-    template<size_t SIMD_W, typename RS, typename Src, typename Dst>
-    inline void _encode_interleaved(RS const& rs, const Src src[], GFT temp[], Dst dst[]) const {
-        // src_size = message_len * interleave
-        // dst_size = ecc_len * interleave
-        // block_len = message_len + ecc_len
-        // chunk_size = block_len * interleave
-        // temp_size = block_len * SIMD_W
-        size_t vec_cols = interleave / SIMD_W;
-        for (size_t i = 0; i < vec_cols; ++i) {
-            vec::copy_stride<true, SIMD_W / 2>(&src[i * SIMD_W], interleave, &temp[0], SIMD_W, SIMD_W, message_len);
-            std::fill_n(&temp[message_len * SIMD_W], ecc_len * SIMD_W, 0);
-            // std::memset(&temp[message_len * SIMD_W], 0, ecc_len * SIMD_W * sizeof(GFT));
-
-            rs.encode(&temp[0]);
-            // std::copy_n(&temp[0], ecc_len * SIMD_W, &dst[i * SIMD_W * ecc_len]);
-
-            // Sequential ecc
-            // vec::copy_transposed(&temp[0], SIMD_W, &dst[i * ecc_len * SIMD_W], ecc_len);
-
-            // Interleaved ecc
-            vec::copy_stride(&temp[0], SIMD_W, &dst[i * SIMD_W], interleave, SIMD_W, ecc_len);
-        }
-        size_t encoded_cols = vec_cols * SIMD_W;
-        if (encoded_cols < interleave) {
-            size_t remaining_cols = interleave - encoded_cols;
-            vec::copy_stride<true, SIMD_W / 2>(&src[encoded_cols], interleave, &temp[0], SIMD_W, remaining_cols, message_len);
-            std::fill_n(&temp[message_len * SIMD_W], ecc_len * SIMD_W, 0);
-            // std::memset(&temp[message_len * SIMD_W], 0, ecc_len * SIMD_W * sizeof(GFT));
-
-            rs.encode(&temp[0]);
-            // vec::copy_stride(&temp[0], SIMD_W, &dst[encoded_cols], remaining_cols, remaining_cols, ecc_len);
-
-            // Sequential ecc
-            // vec::copy_transposed(&temp[0], SIMD_W, remaining_cols, &dst[encoded_cols * ecc_len], ecc_len, ecc_len);
-
-            // Interleaved ecc
-            vec::copy_stride(&temp[0], SIMD_W, &dst[encoded_cols], interleave, remaining_cols, ecc_len);
-        }
+    // storage for encode(reuse_output=True)
+    reusable_output _output;
+
+    /**
+     * Encode `full_blocks` (interleaved) blocks with the GIL released
+     */
+    inline void _encode_blocks(const uint16_t src[], size_t full_blocks, uint16_t dst[], std::optional<size_t> threads) const {
+        if (full_blocks == 0)
+            return;
+
+        size_t encode_threads = threads ? resolve_threads(*threads) : this->threads;
+
+        without_gil([&] {
+            if (interleave == 1)
+                encode_blocks(&src[0], full_blocks, &dst[0], encode_threads);
+            else
+                encode_interleaved_blocks(&src[0], full_blocks, &dst[0], encode_threads);
+        });
     }
 
-    template<size_t SIMD_W, typename T, typename Src, typename Dst>
-    inline void encode_block(T const& rs, const Src src[], GFT temp[], Dst dst[]) const {
-        vec::copy_transposed(&src[0], message_len, &temp[0], SIMD_W);
-        std::fill_n(&temp[message_len * SIMD_W], ecc_len * SIMD_W, 0);
-        // std::memset(&temp[message_len * SIMD_W], 0, ecc_len * SIMD_W * sizeof(GFT));
-
-        rs.encode(&temp[0]);
-        vec::copy_transposed(&temp[0], SIMD_W, &dst[0], ecc_len);
+    /**
+     * Number of threads to encode `len` message symbols split in `groups`
+     */
+    inline size_t _thread_count(size_t threads, size_t len, size_t groups) const {
+        return std::max<size_t>(std::min({threads, len / min_thread_len, groups}), 1);
     }
 
-    template<size_t SIMD_W, typename T, typename Src, typename Dst>
-    inline void encode_block(T const& rs, const Src src[], size_t src_size, GFT temp[], Dst dst[]) const {
-        std::fill_n(&temp[0], block_len * SIMD_W, 0);
-
-        auto cols = src_size / message_len;
-        vec::copy_transposed(&src[0], message_len, message_len, &temp[0], SIMD_W, cols);
-
-        size_t remainder = src_size - cols * message_len;
-        if (remainder) {
-            vec::copy_transposed(&src[src_size - remainder], remainder, remainder, &temp[cols], SIMD_W, 1);
-            ++cols;
-        }
-
-        rs.encode(&temp[0]);
-        vec::copy_transposed(&temp[0], SIMD_W, cols, &dst[0], ecc_len, ecc_len);
+    /**
+     * Encode scratch per task, rounded up to whole cache lines so tasks don't share one
+     */
+    template<size_t SIMD_W>
+    inline size_t _task_scratch_len() const {
+        constexpr size_t line = cache_line / sizeof(GFT);
+        return (ecc_len * 2 * SIMD_W + line - 1) / line * line;
     }
 
-    template<size_t SIMD_W, typename Rs, typename Msg, typename Ecc>
-    inline RepairStatus _repair_interleaved(Rs const& rs, Msg message[], Ecc ecc[], size_t col_start, size_t col_count) const {
+    template<size_t SIMD_W, typename RS, typename Src, typename Dst>
+    inline void _encode_interleaved(RS const& rs, const Src src[], GFT temp[], Dst dst[], size_t col_start, size_t col_end) const {
         // src_size = message_len * interleave
         // dst_size = ecc_len * interleave
-        // block_len = message_len + ecc_len
-        // chunk_size = block_len * interleave
-
-        auto temp_ntt1_ecc6 = new_aligned<GFT>((repair_temp_len) * SIMD_W, SIMD_W * sizeof(GFT));
-        auto buf = new_aligned<GFT>(block_len * SIMD_W, SIMD_W * sizeof(GFT));
-
-        message += col_start;
-
-        // Sequential ecc
-        // ecc += col_start * ecc_len;
-
-        // Interleaved ecc
-        ecc += col_start;
-
-        RepairStatus res = RepairStatus::NoErrors;
-
-        size_t vec_cols = col_count / SIMD_W;
-        for (size_t i = 0; i < vec_cols; ++i) {
-            vec::copy_stride(&message[i * SIMD_W], interleave, &buf[0], SIMD_W, SIMD_W, message_len);
-
-            // Sequential ecc
-            // vec::copy_transposed(&ecc[i * SIMD_W * ecc_len], ecc_len, &buf[message_len * SIMD_W], SIMD_W);
+        // temp_size = ecc_len * 2 * SIMD_W
+        // col_start: multiple of SIMD_W
+        for (size_t col = col_start; col < col_end; col += SIMD_W) {
+            size_t cols = std::min(SIMD_W, col_end - col);
+            rs.encode(&src[col], interleave, 1, cols, &temp[0], &temp[ecc_len * SIMD_W]);
 
             // Interleaved ecc
-            vec::copy_stride(&ecc[i * SIMD_W], interleave, &buf[message_len * SIMD_W], SIMD_W, SIMD_W, ecc_len);
+            vec::store_stride<SIMD_W>(rs.layout, &temp[0], &dst[col], interleave, ecc_len, cols);
+        }
+    }
 
-            res = std::max(res, rs.repair(&buf[0], &temp_ntt1_ecc6[0]));
+    /**
+     * encode_interleaved_blocks with the 16-bit lane encoder, the last columns short of
+     * W lanes fall back to the RSi16v encoder
+     */
+    template<size_t W>
+    inline void _encode_interleaved_epi16(RSi16e<W> const& rs, const uint16_t src[], size_t full_blocks, uint16_t dst[], size_t threads) const {
+        constexpr size_t tile_cols = std::max(W, cache_line / sizeof(uint16_t));
+        size_t tiles = (interleave + tile_cols - 1) / tile_cols;
+        size_t count = full_blocks * tiles;
+        size_t tasks = _thread_count(threads, full_blocks * interleaved_message_len, count);
+        size_t stride = _task_scratch_len<W>();
+        auto scratch = workspace::current().alloc<GFT>(tasks * stride, cache_line);
+
+        parallel_for(tasks, tasks, [&](size_t task) {
+            auto temp = &scratch[task * stride];
+
+            size_t last = count * (task + 1) / tasks;
+            for (size_t i = count * task / tasks; i < last; ++i) {
+                size_t block = i / tiles;
+                size_t col_end = std::min(i % tiles * tile_cols + tile_cols, interleave);
+                auto block_src = &src[block * interleaved_message_len];
+                auto block_dst = &dst[block * interleaved_ecc_len];
+
+                size_t col = i % tiles * tile_cols;
+                for (; col + W <= col_end; col += W)
+                    rs.encode(&block_src[col], interleave, &block_dst[col], interleave, &temp[0]);
+
+                if (col < col_end) {
+                    _simd_dispatch([&]<size_t SIMD_W>(std::integral_constant<size_t, SIMD_W>, auto& rs) {
+                        _encode_interleaved<SIMD_W>(rs, block_src, &temp[0], block_dst, col, col_end);
+                    });
+                }
+            }
+        });
+    }
 
-            vec::copy_stride(&buf[0], SIMD_W, &message[i * SIMD_W], interleave, SIMD_W, message_len);
+    template<size_t SIMD_W, typename Rs, typename Msg, typename Ecc>
+    inline RepairStatus _repair_columns(Rs const& rs, Msg message[], Ecc ecc[], const GFT synds[], const std::pair<size_t, size_t> cols[], size_t count) const {
+        // cols: (estimated errors, column) of the count <= SIMD_W columns to repair
 
-            // Sequential ecc
-            // vec::copy_transposed(&buf[message_len * SIMD_W], SIMD_W, &ecc[i * SIMD_W * ecc_len], ecc_len);
+        auto temp_ecc6 = workspace::current().alloc<GFT>((repair_temp_len) * SIMD_W, SIMD_W * sizeof(GFT));
+        auto buf = workspace::current().alloc<GFT>(block_len * SIMD_W, SIMD_W * sizeof(GFT));
 
-            // Interleaved ecc
-            vec::copy_stride(&buf[message_len * SIMD_W], SIMD_W, &ecc[i * SIMD_W], interleave, SIMD_W, ecc_len);
+        if (count < SIMD_W) {
+            std::fill_n(&buf[0], block_len * SIMD_W, GFT{0});
+            std::fill_n(&temp_ecc6[0], ecc_len * SIMD_W, GFT{0});
         }
 
-        size_t encoded_cols = vec_cols * SIMD_W;
-        if (encoded_cols < col_count) {
-            std::fill_n(&buf[0], block_len * SIMD_W, GFT{0});
+        // column of each lane, and offset of its syndromes
+        std::array<size_t, SIMD_W> col{};
+        std::array<size_t, SIMD_W> synd_col{};
+        for (size_t lane = 0; lane < count; ++lane) {
+            col[lane] = cols[lane].second;
+            synd_col[lane] = col[lane] * ecc_len;
+        }
 
-            size_t remaining_cols = col_count - encoded_cols;
-            vec::copy_stride(&message[encoded_cols], interleave, &buf[0], SIMD_W, remaining_cols, message_len);
+        auto ecc_buf = &buf[message_len * SIMD_W];
+        vec::load_cols<SIMD_W>(rs.layout, &message[0], interleave, &col[0], &buf[0], message_len, count);
+        vec::load_cols<SIMD_W>(rs.layout, &ecc[0], interleave, &col[0], &ecc_buf[0], ecc_len, count);
+        vec::load_cols<SIMD_W>(&synds[0], 1, &synd_col[0], &temp_ecc6[0], ecc_len, count);
 
-            // Sequential ecc
-            // vec::copy_transposed(&ecc[encoded_cols * ecc_len], ecc_len, ecc_len, &buf[message_len * SIMD_W], SIMD_W, remaining_cols);
+        auto res = rs.repair_synd(&buf[0], &temp_ecc6[0]);
 
-            // Interleaved ecc
-            vec::copy_stride(&ecc[encoded_cols], interleave, &buf[message_len * SIMD_W], SIMD_W, remaining_cols, ecc_len);
+        vec::store_cols<SIMD_W>(rs.layout, &buf[0], &message[0], interleave, &col[0], message_len, count);
+        vec::store_cols<SIMD_W>(rs.layout, &ecc_buf[0], &ecc[0], interleave, &col[0], ecc_len, count);
 
-            res = std::max(res, rs.repair(&buf[0], &temp_ntt1_ecc6[0]));
+        return res;
+    }
 
-            vec::copy_stride(&buf[0], SIMD_W, &message[encoded_cols], interleave, remaining_cols, message_len);
+    /**
+     * Split columns sorted by error count into groups of at most W columns
+     * repaired together, choosing the width of each group to minimize the
+     * estimated cost. Returns (width, first, count) of each group.
+     */
+    inline std::vector<std::tuple<size_t, size_t, size_t>> _lane_schedule(std::vector<std::pair<size_t, size_t>> const& cols) const {
+        // Relative cost of one repair at each vector width: time of a repair with
+        // the same error count in every lane over the time of a scalar repair,
+        // rounded from measurements at block_len 256 to 16384, ecc_len / 8 to
+        // ecc_len / 2 - 1 errors (x4: 1.9-2.5, x8: 1.6-2.0, x16 AVX-512F: 2.2-2.7,
+        // x16 as two AVX2 vectors: 3.8-5.1). With fewer errors the wider repairs
+        // cost relatively more, the fixed term below accounts for it.
+        std::vector<std::pair<size_t, double>> widths = {{1, 1.0}};
+        if (simd_x4)
+            widths.emplace_back(4, 2.0);
+        if (simd_x8)
+            widths.emplace_back(8, 2.0);
+        if (simd_x16)
+            widths.emplace_back(16, simd_x16_avx2 ? 4.5 : 2.5);
+
+        // Work independent of the error count (syndromes, root search), in
+        // Sugiyama iterations. A rough fit: the transforms grow with block_len,
+        // each iteration with ecc_len
+        double fixed = 1.0 + double(block_len) / double(8 * ecc_len);
+
+        // cost[i]: cheapest schedule for the first i columns
+        size_t n = cols.size();
+        std::vector<double> cost(n + 1, 0.0);
+        std::vector<size_t> width(n + 1, 1);
+        for (size_t i = 1; i <= n; ++i) {
+            cost[i] = std::numeric_limits<double>::infinity();
+            for (auto [w, w_cost] : widths) {
+                double c = cost[i - std::min(w, i)] + w_cost * (fixed + double(cols[i - 1].first));
+                if (c < cost[i]) {
+                    cost[i] = c;
+                    width[i] = w;
+                }
+            }
+        }
 
-            // Sequential ecc
-            // vec::copy_transposed(&buf[message_len * SIMD_W], SIMD_W, remaining_cols, &ecc[encoded_cols * ecc_len], ecc_len, ecc_len);
+        std::vector<std::tuple<size_t, size_t, size_t>> groups;
+        for (size_t i = n; i > 0; ) {
+            size_t count = std::min(width[i], i);
+            groups.emplace_back(width[i], i - count, count);
+            i -= count;
+        }
+        return groups;
+    }
 
-            // Interleaved ecc
-            vec::copy_stride(&buf[message_len * SIMD_W], SIMD_W, &ecc[encoded_cols], interleave, remaining_cols, ecc_len);
+    /**
+     * Number of errors in a block, from the linear complexity of its
+     * syndromes (Berlekamp-Massey). Only the first 2 * max_errors syndromes
+     * are used, blocks with max_errors or more errors return ecc_len / 2.
+     */
+    inline size_t _error_count(const GFT synds[], size_t max_errors) const {
+        max_errors = std::min(max_errors, ecc_len / 2);
+
+        std::vector<GFT> c(max_errors + 1), b(max_errors + 1), t;
+        c[0] = b[0] = 1;
+
+        size_t l = 0;
+        size_t l_b = 0;
+        size_t m = 1;
+        GFT b_d = 1;
+        for (size_t n = 0; n < 2 * max_errors; ++n) {
+            GFT d = synds[n];
+            for (size_t i = 1; i <= l; ++i)
+                d = gf.add(d, gf.mul(c[i], synds[n - i]));
+
+            if (d == 0) {
+                ++m;
+                continue;
+            }
+
+            bool grow = 2 * l <= n;
+            size_t l_next = grow ? n + 1 - l : l;
+            if (l_next >= max_errors)
+                return ecc_len / 2;
+
+            if (grow)
+                t = c;
+
+            // c -= d / b_d * x^m * b
+            GFT coef = gf.div(d, b_d);
+            for (size_t i = 0; i <= l_b && i + m <= l_next; ++i)
+                c[i + m] = gf.sub(c[i + m], gf.mul(coef, b[i]));
+
+            if (grow) {
+                b = std::move(t);
+                l_b = l;
+                l = l_next;
+                b_d = d;
+                m = 1;
+            } else {
+                ++m;
+            }
         }
-        return res;
+        return l;
     }
 
     template<size_t SIMD_W, typename Rs, typename Msg, typename Ecc>
-    inline RepairStatus _repair_interleaved(Rs const& rs, Msg message[], Ecc ecc[], size_t col_start, size_t col_count, std::vector<size_t> const& error_pos_rbo) const {
+    inline RepairStatus _repair_interleaved(Rs const& rs, Msg message[], Ecc ecc[], size_t col_start, size_t col_count, ErasurePlan const& plan, bool unknown_errors) const {
         // src_size = message_len * interleave
         // dst_size = ecc_len * interleave
         // block_len = message_len + ecc_len
         // interleaved_size = block_len * interleave
 
-        auto temp_ntt1_ecc6 = new_aligned<GFT>((repair_temp_len) * SIMD_W, SIMD_W * sizeof(GFT));
-        auto buf = new_aligned<GFT>(block_len * SIMD_W, SIMD_W * sizeof(GFT));
+        auto temp_ecc8 = workspace::current().alloc<GFT>((repair_temp_len) * SIMD_W, SIMD_W * sizeof(GFT));
+        auto buf = workspace::current().alloc<GFT>(block_len * SIMD_W, SIMD_W * sizeof(GFT));
+
+        auto repair_buf = [&]() {
+            if (unknown_errors)
+                return rs.repair_errata(&buf[0], plan, &temp_ecc8[0]);
+            else
+                return rs.repair(&buf[0], plan, &temp_ecc8[0]);
+        };
 
         message += col_start;
 
@@ -476,23 +899,23 @@ private:
 
         size_t vec_cols = col_count / SIMD_W;
         for (size_t i = 0; i < vec_cols; ++i) {
-            vec::copy_stride(&message[i * SIMD_W], interleave, &buf[0], SIMD_W, SIMD_W, message_len);
+            vec::load_stride<SIMD_W>(rs.layout, &message[i * SIMD_W], interleave, &buf[0], message_len, SIMD_W);
 
             // Sequential ecc
             // vec::copy_transposed(&ecc[i * SIMD_W * ecc_len], ecc_len, &buf[message_len * SIMD_W], SIMD_W);
 
             // Interleaved ecc
-            vec::copy_stride(&ecc[i * SIMD_W], interleave, &buf[message_len * SIMD_W], SIMD_W, SIMD_W, ecc_len);
+            vec::load_stride<SIMD_W>(rs.layout, &ecc[i * SIMD_W], interleave, &buf[message_len * SIMD_W], ecc_len, SIMD_W);
 
-            res = std::max(res, rs.repair(&buf[0], &error_pos_rbo[0], error_pos_rbo.size(), &temp_ntt1_ecc6[0]));
+            res = std::max(res, repair_buf());
 
-            vec::copy_stride(&buf[0], SIMD_W, &message[i * SIMD_W], interleave, SIMD_W, message_len);
+            vec::store_stride<SIMD_W>(rs.layout, &buf[0], &message[i * SIMD_W], interleave, message_len, SIMD_W);
 
             // Sequential ecc
             // vec::copy_transposed(&buf[message_len * SIMD_W], SIMD_W, &ecc[i * SIMD_W * ecc_len], ecc_len);
 
             // Interleaved ecc
-            vec::copy_stride(&buf[message_len * SIMD_W], SIMD_W, &ecc[i * SIMD_W], interleave, SIMD_W, ecc_len);
+            vec::store_stride<SIMD_W>(rs.layout, &buf[message_len * SIMD_W], &ecc[i * SIMD_W], interleave, ecc_len, SIMD_W);
         }
 
         size_t encoded_cols = vec_cols * SIMD_W;
@@ -508,7 +931,7 @@ private:
             // Interleaved ecc
             vec::copy_stride(&ecc[encoded_cols], interleave, &buf[message_len * SIMD_W], SIMD_W, remaining_cols, ecc_len);
 
-            res = std::max(res, rs.repair(&buf[0], &error_pos_rbo[0], error_pos_rbo.size(), &temp_ntt1_ecc6[0]));
+            res = std::max(res, repair_buf());
 
             vec::copy_stride(&buf[0], SIMD_W, &message[encoded_cols], interleave, remaining_cols, message_len);
 
@@ -523,7 +946,9 @@ private:
 
     template<typename F>
     inline auto _simd_dispatch(F&& f) const {
-        if (simd_x16)
+        if (simd_x16 && simd_x16_avx2)
+            return f(std::integral_constant<size_t, 16>{}, rs16x8x2);
+        else if (simd_x16)
             return f(std::integral_constant<size_t, 16>{}, rs16x16);
         else if (simd_x8)
             return f(std::integral_constant<size_t, 8>{}, rs16x8);
@@ -533,18 +958,20 @@ private:
             return f(std::integral_constant<size_t, 1>{}, rs16);
     }
 
-    template<size_t W>
-    inline RSi16v<W> const& rs() const {
-        if constexpr (W == 16)
-            return rs16x16;
-        else if constexpr (W == 8)
-            return rs16x8;
-        else if constexpr (W == 4)
-            return rs16x4;
-        else if constexpr (W == 1)
-            return rs16;
-        else
-            static_assert(W == 1 || W == 4 || W == 8 || W == 16, "Unsupported SIMD width");
+    template<typename F>
+    inline auto _simd_dispatch(size_t width, F&& f) const {
+        switch (width) {
+        case 16:
+            if (simd_x16_avx2)
+                return f(std::integral_constant<size_t, 16>{}, rs16x8x2);
+            return f(std::integral_constant<size_t, 16>{}, rs16x16);
+        case 8:
+            return f(std::integral_constant<size_t, 8>{}, rs16x8);
+        case 4:
+            return f(std::integral_constant<size_t, 4>{}, rs16x4);
+        default:
+            return f(std::integral_constant<size_t, 1>{}, rs16);
+        }
     }
 
     template<typename T>
@@ -565,69 +992,108 @@ private:
     }
 
 
-    inline py::bytearray py_encode(buffer_ro<uint16_t> buf) {
-        if (buf.size == 0)
-            return {};
+    inline py::object py_encode(buffer_ro<uint16_t> buf, std::optional<size_t> threads, bool reuse_output, workspace *ws) {
+        workspace::use scratch(ws);
 
         py_assert(buf.size % interleaved_message_len == 0, std::to_string(buf.size));
 
         size_t full_blocks = buf.size / interleaved_message_len;
-        size_t output_size = full_blocks * interleaved_ecc_len;
+        auto [output, output_data] = output_buffer(full_blocks * interleaved_ecc_len * sizeof(uint16_t),
+                                                   reuse_output ? &_output : nullptr);
 
-        auto output = py::bytearray(nullptr, output_size * sizeof(uint16_t));
-        auto output_data = reinterpret_cast<uint16_t *>(PyByteArray_AsString(output.ptr()));
+        _encode_blocks(&buf[0], full_blocks, reinterpret_cast<uint16_t *>(output_data), threads);
+        return output;
+    }
 
-        if (interleave == 1)
-            encode_blocks(&buf[0], full_blocks, &output_data[0]);
-        else
-            encode_interleaved_blocks(&buf[0], full_blocks, &output_data[0]);
+    inline size_t py_encode_into(buffer_ro<uint16_t> buf, buffer_out<uint16_t> ecc_out, std::optional<size_t> threads, workspace *ws) {
+        workspace::use scratch(ws);
 
-        return output;
+        py_assert(buf.size % interleaved_message_len == 0, std::to_string(buf.size));
+
+        size_t full_blocks = buf.size / interleaved_message_len;
+        size_t output_size = full_blocks * interleaved_ecc_len;
+        py_assert(ecc_out.size >= output_size, std::to_string(ecc_out.size) + " < " + std::to_string(output_size));
+
+        _encode_blocks(&buf[0], full_blocks, &ecc_out[0], threads);
+        return output_size * sizeof(uint16_t);
     }
 
-    inline RepairStatus py_repair(buffer_rw<uint16_t> message, buffer_rw<uint16_t> ecc, std::optional<std::vector<size_t>> const& error_pos) {
-        RepairStatus res = RepairStatus::NoErrors;
+    inline RepairStatus py_repair(buffer_rw<uint16_t> message, buffer_rw<uint16_t> ecc, std::optional<std::vector<size_t>> const& error_pos, bool unknown_errors, workspace *ws) {
+        workspace::use scratch(ws);
 
-        if (error_pos && error_pos->empty())
+        if (error_pos && error_pos->empty() && !unknown_errors)
             return RepairStatus::NoErrors;
 
         if (interleave == 1) {
             py_assert(message.size == message_len, std::to_string(message.size));
             py_assert(ecc.size == ecc_len, std::to_string(ecc.size));
+        } else {
+            py_assert(message.size == interleaved_message_len, std::to_string(message.size));
+            py_assert(ecc.size == interleaved_ecc_len, std::to_string(ecc.size));
+        }
 
-            auto buf = new_aligned<GFT>(block_len, vec_align);
+        if (error_pos)
+            py_assert(error_pos->size() <= ecc_len);
 
-            std::copy_n(&message[0], message_len, &buf[0]);
-            std::copy_n(&ecc[0], ecc_len, &buf[message_len]);
+        return without_gil([&] {
+            RepairStatus res = RepairStatus::NoErrors;
 
-            auto temp_ntt1_ecc6 = new_aligned<GFT>(repair_temp_len, sizeof(GFT));
-            if (error_pos) {
-                py_assert(error_pos->size() <= ecc_len);
+            if (interleave == 1) {
+                auto buf = workspace::current().alloc<GFT>(block_len, vec_align);
 
-                auto error_pos_rbo = std::vector<size_t>(error_pos->size());
-                for (size_t i = 0; i < error_pos->size(); ++i)
-                    error_pos_rbo[i] = ntt.rbo((*error_pos)[i]);
+                std::copy_n(&message[0], message_len, &buf[0]);
+                std::copy_n(&ecc[0], ecc_len, &buf[message_len]);
 
-                res = rs16.repair(&buf[0], &error_pos_rbo[0], error_pos_rbo.size(), &temp_ntt1_ecc6[0]);
-            } else {
-                res = rs16.repair(&buf[0], &temp_ntt1_ecc6[0]);
-            }
+                auto temp_ecc8 = workspace::current().alloc<GFT>(repair_temp_len, sizeof(GFT));
+                if (error_pos) {
+                    auto error_pos_rbo = std::vector<size_t>(error_pos->size());
+                    for (size_t i = 0; i < error_pos->size(); ++i)
+                        error_pos_rbo[i] = ntt.rbo((*error_pos)[i]);
 
-            std::copy_n(&buf[0], message_len, &message[0]);
-            std::copy_n(&buf[message_len], ecc_len, &ecc[0]);
-        } else {
-            py_assert(message.size == interleaved_message_len, std::to_string(message.size));
-            py_assert(ecc.size == interleaved_ecc_len, std::to_string(ecc.size));
+                    if (unknown_errors)
+                        res = rs16.repair_errata(&buf[0], &error_pos_rbo[0], error_pos_rbo.size(), &temp_ecc8[0]);
+                    else
+                        res = rs16.repair(&buf[0], &error_pos_rbo[0], error_pos_rbo.size(), &temp_ecc8[0]);
+                } else {
+                    res = rs16.repair(&buf[0], &temp_ecc8[0]);
+                }
 
-            if (error_pos) {
-                py_assert(error_pos->size() <= ecc_len);
-                res = repair_interleaved(&message[0], &ecc[0], 0, interleave, *error_pos);
+                std::copy_n(&buf[0], message_len, &message[0]);
+                std::copy_n(&buf[message_len], ecc_len, &ecc[0]);
             } else {
-                res = repair_interleaved(&message[0], &ecc[0], 0, interleave);
+                if (error_pos)
+                    res = repair_interleaved(&message[0], &ecc[0], 0, interleave, *error_pos, unknown_errors);
+                else
+                    res = repair_interleaved(&message[0], &ecc[0], 0, interleave);
             }
-        }
 
-        return res;
+            return res;
+        });
+    }
+
+    inline void py_repair_ntt(buffer_rw<uint16_t> message, buffer_rw<uint16_t> ecc, std::vector<size_t> const& error_pos) {
+        py_assert(interleave == 1);
+        py_assert(message.size == message_len, std::to_string(message.size));
+        py_assert(ecc.size == ecc_len, std::to_string(ecc.size));
+        py_assert(error_pos.size() <= ecc_len);
+
+        without_gil([&] {
+            // the transform covers ntt_len, past block_len is zero
+            auto block = workspace::current().alloc<GFT>(ntt.ntt_len, sizeof(GFT));
+            std::copy_n(&message[0], message_len, &block[0]);
+            std::copy_n(&ecc[0], ecc_len, &block[message_len]);
+            std::fill(&block[block_len], &block[ntt.ntt_len], GFT{0});
+
+            auto error_pos_rbo = std::vector<size_t>(error_pos.size());
+            for (size_t i = 0; i < error_pos.size(); ++i)
+                error_pos_rbo[i] = ntt.rbo(error_pos[i]);
+
+            auto temp_ntt1_ecc6 = workspace::current().alloc<GFT>(ntt.ntt_len + ecc_len * 6, sizeof(GFT));
+            rs16.repair_ntt(&block[0], error_pos_rbo.data(), error_pos_rbo.size(), &temp_ntt1_ecc6[0]);
+
+            std::copy_n(&block[0], message_len, &message[0]);
+            std::copy_n(&block[message_len], ecc_len, &ecc[0]);
+        });
     }
 
     inline std::vector<GFT> py_synd(buffer_ro<uint16_t> message, buffer_ro<uint16_t> ecc) {
@@ -637,45 +1103,41 @@ private:
         size_t count = message.size / message_len;
         py_assert(ecc.size / ecc_len == count);
 
-        auto temp = new_aligned<GFT>(block_len, sizeof(GFT));
         std::vector<GFT> synd;
         synd.resize(count * ecc_len);
 
-        std::copy_n(&message[0], message_len, &temp[0]);
-        std::copy_n(&ecc[0], ecc_len, &temp[message_len]);
-
-        ntt.pntt(&temp[0]);
-        synd_blocks(&message[0], &ecc[0], count, &temp[0], &synd[0]);
+        without_gil([&] { synd_blocks(&message[0], &ecc[0], count, &synd[0]); });
 
         return synd;
     }
 
     template<size_t W>
     inline py::tuple py_sugiyama(std::vector<GFT> synd) {
-        auto repair_temp = new_aligned<GFT>(repair_temp_len * W, W * sizeof(GFT));
-        auto const& rs = this->rs<W>();
+        return _simd_dispatch(W, [&]<size_t SIMD_W>(std::integral_constant<size_t, SIMD_W>, auto& rs) {
+            auto repair_temp = workspace::current().alloc<GFT>(repair_temp_len * SIMD_W, SIMD_W * sizeof(GFT));
 
-        auto a1 = &repair_temp[0];
-        auto r1 = &repair_temp[W * ecc_len];
-        auto temp_ecc4 = &repair_temp[2 * W * ecc_len];
+            auto a1 = &repair_temp[0];
+            auto r1 = &repair_temp[SIMD_W * ecc_len];
+            auto temp_ecc4 = &repair_temp[2 * SIMD_W * ecc_len];
 
-        vec::copy_transposed(&synd[0], ecc_len, &r1[0], W);
+            vec::copy_transposed(&synd[0], ecc_len, &r1[0], SIMD_W);
 
-        rs.sugiyama(&a1[0], &r1[0], &temp_ecc4[0]);
+            rs.sugiyama(&a1[0], &r1[0], &temp_ecc4[0]);
 
-        std::vector<GFT> locator, evaluator;
-        locator.resize(W * ecc_len);
-        evaluator.resize(W * ecc_len);
+            std::vector<GFT> locator, evaluator;
+            locator.resize(SIMD_W * ecc_len);
+            evaluator.resize(SIMD_W * ecc_len);
 
-        vec::copy_transposed(&a1[0], W, &locator[0], ecc_len);
-        vec::copy_transposed(&r1[0], W, &evaluator[0], ecc_len);
+            vec::copy_transposed(&a1[0], SIMD_W, &locator[0], ecc_len);
+            vec::copy_transposed(&r1[0], SIMD_W, &evaluator[0], ecc_len);
 
-        return py::make_tuple(locator, evaluator);
+            return py::make_tuple(locator, evaluator);
+        });
     }
 
     inline std::vector<size_t> py_roots(std::vector<GFT> poly) {
         py_assert(poly.size() == ecc_len);
-        auto temp = new_aligned<GFT>(block_len, sizeof(GFT));
+        auto temp = workspace::current().alloc<GFT>(block_len, sizeof(GFT));
 
         std::copy_n(&poly[0], ecc_len, &temp[0]);
         std::fill_n(&temp[ecc_len], block_len - ecc_len, 0);
@@ -0,0 +1,129 @@
+/**************************************************************************
+ * rsi16e_impl.hpp
+ *
+ * Copyright 2026 Gabriel Machado
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************/
+
+# pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "rsi16v.hpp"
+#include "ntt.hpp"
+
+
+/**
+ * 16-bit lane arithmetic of one instruction set, specialized by the translation unit
+ * instantiating RSi16e<W>. `type` holds W values x + 65536 * e with x == 0 where e is
+ * set, in W * sizeof(GFT) bytes:
+ *   load(src), store(dst, a), zero()
+ *   add(a, b), sub(a, b), mul(a, epi16_factor)
+ */
+template<size_t W>
+struct epi16;
+
+
+template<size_t W>
+RSi16e<W>::RSi16e(NTT const& ntt, std::vector<::GFT> const& ecc_mix):
+    ecc_len(ntt.ecc_len),
+    blocks(ntt.pntt_blocks - 1)
+{
+    for (size_t len = 2; len <= ecc_len; len *= 2) {
+        for (size_t j = 0; j < len / 2; ++j) {
+            _tw_ct.push_back(epi16_factor::of(ntt._roots_ecc[j * (ecc_len / len)]));
+            _tw_gs.push_back(epi16_factor::of(ntt._roots_i_ecc[j * (ecc_len / len)]));
+        }
+    }
+
+    for (size_t i = 0; i < blocks * ecc_len; ++i)
+        _shift.push_back(epi16_factor::of(ntt._pntt_shift[i]));
+
+    for (size_t j = 0; j < ecc_len; ++j)
+        _mix.push_back(epi16_factor::of(ecc_mix[j]));
+}
+
+
+/**
+ * Same steps as NTT::pntt_message_residue and RSi16v::_mix_ecc_residue on radix-2
+ * butterflies: forward transform of each message sub-block (bit-reversed rows in,
+ * natural order out), multiply-accumulate with the sub-block shift, ecc mix, inverse
+ * transform back to bit-reversed order.
+ */
+template<size_t W>
+void RSi16e<W>::encode(const uint16_t src[], size_t row_stride, uint16_t ecc[], size_t ecc_stride, ::GFT temp[]) const {
+    using op = epi16<W>;
+    using V = typename op::type;
+    static_assert(sizeof(V) == W * sizeof(::GFT));
+
+    const size_t len = ecc_len;
+    auto acc = reinterpret_cast<V *>(&temp[0]);
+    auto p = reinterpret_cast<V *>(&temp[len * W]);
+
+    if (blocks == 0)
+        std::fill_n(acc, len, op::zero());
+
+    for (size_t i = 0; i < blocks; ++i) {
+        for (size_t r = 0; r < len; ++r)
+            p[r] = op::load(&src[(i * len + r) * row_stride]);
+
+        auto tw = &_tw_ct[0];
+        for (size_t h = 1; h < len; h *= 2) {
+            for (size_t g = 0; g < len; g += 2 * h) {
+                for (size_t j = 0; j < h; ++j) {
+                    auto u = p[g + j];
+                    // tw[0] == 1
+                    auto v = j == 0 ? p[g + j + h] : op::mul(p[g + j + h], tw[j]);
+                    p[g + j] = op::add(u, v);
+                    p[g + j + h] = op::sub(u, v);
+                }
+            }
+            tw += h;
+        }
+
+        auto shift = &_shift[i * len];
+        if (i == 0) {
+            for (size_t j = 0; j < len; ++j)
+                acc[j] = op::mul(p[j], shift[j]);
+        } else {
+            for (size_t j = 0; j < len; ++j)
+                acc[j] = op::add(acc[j], op::mul(p[j], shift[j]));
+        }
+    }
+
+    for (size_t j = 0; j < len; ++j)
+        acc[j] = op::mul(acc[j], _mix[j]);
+
+    auto tw_end = &_tw_gs[0] + _tw_gs.size();
+    for (size_t h = len / 2; h >= 1; h /= 2) {
+        auto tw = tw_end - h;
+        tw_end = tw;
+        for (size_t g = 0; g < len; g += 2 * h) {
+            for (size_t j = 0; j < h; ++j) {
+                auto u = acc[g + j];
+                auto v = acc[g + j + h];
+                acc[g + j] = op::add(u, v);
+                acc[g + j + h] = j == 0 ? op::sub(u, v) : op::mul(op::sub(u, v), tw[j]);
+            }
+        }
+    }
+
+    for (size_t j = 0; j < len; ++j)
+        op::store(&ecc[j * ecc_stride], acc[j]);
+}
+
+
+#define RSI16E_IMPL_INSTANTIATE(W) \
+    template class RSi16e<W>;
@@ -45,3 +45,60 @@ void vec::copy_n_masked(const GFT src[], size_t n, GFT dst[], GFT const& conditi
             dst[i] = src[i];
     }
 }
+
+
+const vec::layout_kernels vec::layout_scalar = vec::layout_kernels::of<1>();
+
+
+ErasurePlan::ErasurePlan(NTT const& ntt, std::vector<size_t> const& error_pos):
+    error_pos(error_pos),
+    error_pos_rbo(error_pos.size()),
+    locator_ntt(ntt.ecc_len * 2, 0),
+    forney(error_pos.size() * error_pos.size())
+{
+    auto const& gf = ntt.gf;
+    size_t error_count = error_pos.size();
+
+    for (size_t k = 0; k < error_count; ++k)
+        error_pos_rbo[k] = ntt.rbo(error_pos[k]);
+
+    // locator = prod(1 - x * X_k)
+    std::vector<GFT> locator(error_count + 1, 0);
+    locator[0] = 1;
+    for (size_t k = 0; k < error_count; ++k) {
+        GFT x = ntt._roots_ntt[error_pos_rbo[k]];
+        for (size_t i = k + 1; i > 0; --i)
+            locator[i] = gf.sub(locator[i], gf.mul(locator[i - 1], x));
+    }
+
+    std::copy(locator.begin(), locator.end(), locator_ntt.begin());
+    ntt.nttr2(&locator_ntt[0]);
+    locator_ntt_q = ntt.shoup_q(locator_ntt);
+
+    // error_k = omega(x) / (x * locator'(x)) at x = 1 / X_k, with
+    // omega = synds * locator mod x^error_count:
+    // forney[k][j] = x^j * sum(locator[m] * x^m, m < error_count - j) / (x * locator'(x))
+    for (size_t k = 0; k < error_count; ++k) {
+        GFT x = ntt._roots_i_ntt[error_pos_rbo[k]];
+
+        GFT deriv = 0;
+        for (size_t i = error_count; i > 0; --i)
+            deriv = gf.add(gf.mul(deriv, x), gf.mul(locator[i], GFT(i)));
+        GFT scale = gf.inv(gf.mul(deriv, x));
+
+        // partial[n] = sum(locator[m] * x^m, m < n)
+        std::vector<GFT> partial(error_count + 1, 0);
+        GFT x_m = 1;
+        for (size_t m = 0; m < error_count; ++m) {
+            partial[m + 1] = gf.add(partial[m], gf.mul(locator[m], x_m));
+            x_m = gf.mul(x_m, x);
+        }
+
+        GFT x_j = scale;
+        for (size_t j = 0; j < error_count; ++j) {
+            forney[k * error_count + j] = gf.mul(x_j, partial[error_count - j]);
+            x_j = gf.mul(x_j, x);
+        }
+    }
+    forney_q = ntt.shoup_q(forney);
+}
@@ -38,35 +38,90 @@ enum class RepairStatus : uint32_t {
 };
 
 
-template<size_t W>
+/**
+ * Erasure decoding of a fixed set of known error positions, computed once and
+ * shared by every column repaired with the same positions. Without errors at
+ * other positions the error evaluator has degree < error_count, so the error
+ * at error_pos[k] is the dot product of the first error_count syndromes with
+ * forney[k * error_count ...]. At most ecc_len positions.
+ */
+struct ErasurePlan {
+    std::vector<size_t> error_pos;
+    std::vector<size_t> error_pos_rbo;
+
+    // nttr2 of the erasure locator prod(1 - x * X_k), ecc_len * 2
+    std::vector<::GFT> locator_ntt;
+    std::vector<::GFT> locator_ntt_q;
+
+    // error_count * error_count
+    std::vector<::GFT> forney;
+    std::vector<::GFT> forney_q;
+
+    ErasurePlan(NTT const& ntt, std::vector<size_t> const& error_pos);
+
+    inline size_t error_count() const { return error_pos.size(); }
+};
+
+
+/**
+ * W lanes of vector type V, the native vector of that width unless built as two halves
+ * (see vec::x2). `layout` holds the uint16_t conversions of the same instruction set.
+ */
+template<size_t W, typename V = simd_map_t<W>>
 class RSi16v {
     const GFi16 &gf;
     const NTT &ntt;
 
 public:
+    vec::layout_kernels const& layout;
+
     std::vector<::GFT> _ecc_mix;
     std::vector<::GFT> _ecc_mix_i;
+    std::vector<::GFT> _ecc_mix_q;
 
     const ::GFT root;
     const size_t ntt_len;
     const size_t block_len;
     const size_t ecc_len;
     const ::GFT ecc_len_mask;
-    using GFT = simd_map_t<W>;
+    using GFT = V;
     using cGFT = const GFT *const;
     using mGFT = GFT *const;
 
-    RSi16v(NTT const& ntt, size_t block_len, size_t ecc_len);
+    RSi16v(NTT const& ntt, size_t block_len, size_t ecc_len, vec::layout_kernels const& layout);
     ~RSi16v();
 
     inline void encode(::GFT block[]) const
         { _encode(reinterpret_cast<GFT *>(block)); }
 
-    inline RepairStatus repair(::GFT block[], const size_t error_pos_rbo[], size_t error_count, ::GFT temp_ntt1_ecc6[]) const
-        { return _repair(reinterpret_cast<GFT *>(block), error_pos_rbo, error_count, reinterpret_cast<GFT *>(temp_ntt1_ecc6)); }
+    /**
+     * Encode the message columns read in place from `src`, symbol `row` of column `col`
+     * at src[row * row_stride + col * col_stride], columns [cols, W) are zero.
+     * ecc: ecc_len (output), temp_ecc: ecc_len
+     */
+    inline void encode(const uint16_t src[], size_t row_stride, size_t col_stride, size_t cols, ::GFT ecc[], ::GFT temp_ecc[]) const
+        { _encode(src, row_stride, col_stride, cols, reinterpret_cast<GFT *>(ecc), reinterpret_cast<GFT *>(temp_ecc)); }
+
+    inline void encode(const ::GFT src[], size_t row_stride, size_t col_stride, size_t cols, ::GFT ecc[], ::GFT temp_ecc[]) const
+        { _encode(src, row_stride, col_stride, cols, reinterpret_cast<GFT *>(ecc), reinterpret_cast<GFT *>(temp_ecc)); }
+
+    inline RepairStatus repair(::GFT block[], const size_t error_pos_rbo[], size_t error_count, ::GFT temp_ecc6[]) const
+        { return _repair(reinterpret_cast<GFT *>(block), error_pos_rbo, error_count, reinterpret_cast<GFT *>(temp_ecc6)); }
+
+    inline RepairStatus repair(::GFT block[], ::GFT temp_ecc6[]) const
+        { return _repair(reinterpret_cast<GFT *>(block), reinterpret_cast<GFT *>(temp_ecc6)); }
+
+    inline RepairStatus repair_synd(::GFT block[], ::GFT temp_ecc6[]) const
+        { return _repair_synd(reinterpret_cast<GFT *>(block), reinterpret_cast<GFT *>(temp_ecc6)); }
+
+    inline RepairStatus repair_errata(::GFT block[], const size_t erasure_pos_rbo[], size_t erasure_count, ::GFT temp_ecc8[]) const
+        { return _repair_errata(reinterpret_cast<GFT *>(block), erasure_pos_rbo, erasure_count, reinterpret_cast<GFT *>(temp_ecc8)); }
+
+    inline RepairStatus repair(::GFT block[], ErasurePlan const& plan, ::GFT temp_ecc6[]) const
+        { return _repair(reinterpret_cast<GFT *>(block), plan, reinterpret_cast<GFT *>(temp_ecc6)); }
 
-    inline RepairStatus repair(::GFT block[], ::GFT temp_ntt1_ecc6[]) const
-        { return _repair(reinterpret_cast<GFT *>(block), reinterpret_cast<GFT *>(temp_ntt1_ecc6)); }
+    inline RepairStatus repair_errata(::GFT block[], ErasurePlan const& plan, ::GFT temp_ecc8[]) const
+        { return _repair_errata(reinterpret_cast<GFT *>(block), plan, reinterpret_cast<GFT *>(temp_ecc8)); }
 
     inline void repair_ntt(::GFT block[], const size_t error_pos_rbo[], size_t error_count, ::GFT temp_ntt1_ecc6[]) const
         { _repair_ntt(reinterpret_cast<GFT *>(block), error_pos_rbo, error_count, reinterpret_cast<GFT *>(temp_ntt1_ecc6)); }
@@ -74,19 +129,31 @@ public:
     inline void mix_ecc(::GFT ecc[]) const
         { _mix_ecc(reinterpret_cast<GFT *>(ecc)); }
 
+    inline void synd(::GFT block[]) const
+        { _synd(reinterpret_cast<GFT *>(block)); }
+
     void sugiyama(::GFT a1[], ::GFT r1[], ::GFT temp_ecc4[]) const;
 
 protected:
     void _encode(GFT block[]) const;
-    RepairStatus _repair(GFT block[], GFT temp_ntt1_ecc6[]) const;
-    RepairStatus _repair(GFT block[], const size_t error_pos_rbo[], size_t error_count, GFT temp_ntt1_ecc6[]) const;
+    template<typename Src>
+    void _encode(const Src src[], size_t row_stride, size_t col_stride, size_t cols, GFT ecc[], GFT temp_ecc[]) const;
+    RepairStatus _repair(GFT block[], GFT temp_ecc6[]) const;
+    RepairStatus _repair_synd(GFT block[], GFT temp_ecc6[]) const;
+    RepairStatus _repair(GFT block[], const size_t error_pos_rbo[], size_t error_count, GFT temp_ecc6[]) const;
+    RepairStatus _repair_errata(GFT block[], const size_t erasure_pos_rbo[], size_t erasure_count, GFT temp_ecc8[]) const;
+    RepairStatus _repair(GFT block[], ErasurePlan const& plan, GFT temp_ecc6[]) const;
+    RepairStatus _repair_errata(GFT block[], ErasurePlan const& plan, GFT temp_ecc8[]) const;
     void _repair_ntt(GFT block[], const size_t error_pos_rbo[], size_t error_count, GFT temp_ntt1_ecc6[]) const;
+    void _repair_ntt_eval(GFT block[], const size_t error_pos_rbo[], size_t error_count, GFT temp_ntt1_ecc6[]) const;
     void _mix_ecc(GFT ecc[]) const;
-    void _mix_ecc_residue(GFT ecc[]) const;
+    void _synd(GFT block[]) const;
+    void _mix_ecc_residue(GFT ecc[], uint64_t bound) const;
 
 private:
-    GFT _sugiyama(GFT *a1, GFT *r1, GFT *temp_ecc4) const;
-    GFT _forney(const GFT *locator_poly_deriv, size_t locator_poly_deriv_len, const GFT *evaluator_poly, size_t evaluator_poly_len, const ::GFT& x) const;
+    GFT _sugiyama(GFT *a1, GFT *r1, GFT *temp_ecc4, size_t erasure_count = 0) const;
+    void _forney_plan(ErasurePlan const& plan, const GFT *synds, GFT *block) const;
+    GFT _forney(const GFT *locator_poly_deriv, size_t locator_poly_deriv_len, const GFT *evaluator_poly, size_t evaluator_poly_len, const GFT& x_inv) const;
     void _error_locator_rev(const size_t *error_pos_rbo, size_t error_count, GFT *locator_poly) const;
     void _error_locator(const size_t *error_pos_rbo, size_t error_count, GFT *locator_poly) const;
     void _error_evaluator(const GFT *locator_poly, size_t locator_poly_deg, GFT *evaluator_poly, GFT *temp) const;
@@ -104,3 +171,50 @@ private:
     void _reverse_ntt(GFT *vec, size_t shift) const;
     void _reverse_ntt_vec(GFT *vec, GFT shift) const;
 };
+
+
+/**
+ * Multiplier of a 16-bit lane product: w, -w in 16 bits for lanes holding 65536
+ * (neg_e when -w is 65536 itself), neg when w is 65536 and the product is a negation.
+ */
+struct epi16_factor {
+    uint16_t w;
+    uint16_t neg_w;
+    uint16_t neg_e;
+    uint16_t neg;
+
+    static inline epi16_factor of(::GFT w) {
+        ::GFT n = (0x10001 - w) % 0x10001;
+        return {uint16_t(w), uint16_t(n), uint16_t(n == 0x10000), uint16_t(w == 0x10000)};
+    }
+};
+
+
+/**
+ * Encoder holding W symbols in 16-bit lanes instead of 32, W = 16 (AVX2) or 32
+ * (AVX-512BW). 65536 doesn't fit and is kept as 0 plus a lane mask, products
+ * use mullo/mulhi_epu16 reduced with 2^16 = -1. Every sum is reduced exactly,
+ * there is no headroom for the lazy reductions of RSi16v. Same output as
+ * RSi16v::encode stored to uint16_t.
+ */
+template<size_t W>
+class RSi16e {
+public:
+    const size_t ecc_len;
+    // message sub-blocks of ecc_len rows
+    const size_t blocks;
+
+    // per butterfly pass, see NTT::_roots_ecc
+    std::vector<epi16_factor> _tw_ct;
+    std::vector<epi16_factor> _tw_gs;
+    std::vector<epi16_factor> _shift;
+    std::vector<epi16_factor> _mix;
+
+    RSi16e(NTT const& ntt, std::vector<::GFT> const& ecc_mix);
+
+    /**
+     * Encode the W message columns at src[row * row_stride + col] into
+     * ecc[row * ecc_stride + col]. temp: ecc_len * 2 * W, 64-byte aligned
+     */
+    void encode(const uint16_t src[], size_t row_stride, uint16_t ecc[], size_t ecc_stride, ::GFT temp[]) const;
+};
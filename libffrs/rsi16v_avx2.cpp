@@ -21,6 +21,7 @@
 
 #define RSI16V_IMPL_INSTANCE_W 8
 #include "rsi16v_impl.hpp"
+#include "rsi16e_impl.hpp"
 
 #include "simd.hpp"
 
@@ -35,31 +36,530 @@ GFTx8 ffrs::simd_gather_base::gather(const uint32_t vec[], GFTx8 const& i) {
 }
 
 
+template<>
+simd_mask_t vec::is_zero<GFTx8>(GFTx8 const& vec) {
+    // return std::all_of(
+    //     reinterpret_cast<const uint32_t *>(&vec),
+    //     reinterpret_cast<const uint32_t *>(&vec) + 8,
+    //     [](auto v) { return v == 0; }
+    // );
+    return _mm256_testz_si256((__m256i) vec, (__m256i) vec);
+}
+
+
+static inline __m256i cmplt_epu32(__m256i a, __m256i b) {
+    return _mm256_xor_si256(
+        _mm256_cmpeq_epi32(_mm256_max_epu32(a, b), a),
+        _mm256_set1_epi32(-1)
+    );
+}
+
+
+static inline __m256i nonzero_mask(GFTx8 const& condition) {
+    return _mm256_xor_si256(
+        _mm256_cmpeq_epi32((__m256i) condition, _mm256_setzero_si256()),
+        _mm256_set1_epi32(-1)
+    );
+}
+
+
+/**
+ * Element offsets of `src[row[j]][lane0 + j]` for 32-bit gathers from rows of W lanes
+ */
+template<size_t W>
+static inline __m256i row_index(__m256i row, int lane0 = 0) {
+    static_assert(W == 8 || W == 16);
+    return _mm256_add_epi32(
+        _mm256_slli_epi32(row, W == 8 ? 3 : 4),
+        _mm256_setr_epi32(lane0, lane0 + 1, lane0 + 2, lane0 + 3, lane0 + 4, lane0 + 5, lane0 + 6, lane0 + 7));
+}
+
+
 template<>
 void vec::assign_masked<GFTx8>(GFTx8& vec, GFTx8 const& value, GFTx8 const& condition) {
-    for (int j = 0; j < 8; j++)
-        if (condition[j])
-            vec[j] = value[j];
+    auto keep = _mm256_cmpeq_epi32((__m256i) condition, _mm256_setzero_si256());
+    vec = (GFTx8) _mm256_blendv_epi8((__m256i) value, (__m256i) vec, keep);
 }
 
 
 template<>
 void vec::copy_n_masked<GFTx8>(const GFTx8 src[], size_t n, GFTx8 dst[], GFTx8 const& condition) {
-    // TODO: test if copying columns perform better
+    auto mask = nonzero_mask(condition);
+    for (size_t i = 0; i < n; i++)
+        _mm256_maskstore_epi32((int *) &dst[i], mask, (__m256i) src[i]);
+}
+
+
+template<>
+GFTx8 vec::min<GFTx8>(GFTx8 const& a, GFTx8 const& b) {
+    return (GFTx8) _mm256_min_epu32((__m256i) a, (__m256i) b);
+}
+
+
+template<>
+GFTx8 vec::max<GFTx8>(GFTx8 const& a, GFTx8 const& b) {
+    return (GFTx8) _mm256_max_epu32((__m256i) a, (__m256i) b);
+}
+
+
+template<>
+GFT vec::min<GFTx8>(GFTx8 const& a) {
+    auto m = _mm_min_epu32(_mm256_castsi256_si128((__m256i) a), _mm256_extracti128_si256((__m256i) a, 1));
+    m = _mm_min_epu32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+    m = _mm_min_epu32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+    return GFT(_mm_cvtsi128_si32(m));
+}
+
+
+template<>
+GFT vec::max<GFTx8>(GFTx8 const& a) {
+    auto m = _mm_max_epu32(_mm256_castsi256_si128((__m256i) a), _mm256_extracti128_si256((__m256i) a, 1));
+    m = _mm_max_epu32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+    m = _mm_max_epu32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+    return GFT(_mm_cvtsi128_si32(m));
+}
+
+
+template<>
+GFTx8 vec::gather<GFTx8>(const GFTx8 src[], GFTx8 const& i) {
+    return (GFTx8) _mm256_i32gather_epi32((const int *) src, row_index<8>((__m256i) i), 4);
+}
+
+
+/**
+ * Iterate over destination rows so that every store is a full row: lane j
+ * of row r is written when r - dst_offset[j] < n[j]. Handles lanes
+ * lane0..lane0+7 of rows of W lanes.
+ */
+template<size_t W>
+static void copy_n_rows(const GFT src[], GFTx8 const& src_offset, GFTx8 n, GFT dst[], GFTx8 const& dst_offset, int lane0) {
+    auto active = (GFTx8) (n != 0);
+    if (vec::is_zero(active))
+        return;
+
+    size_t begin = vec::min(dst_offset | ~active);
+    size_t end = vec::max((dst_offset + n) & active);
+
+    for (size_t r = begin; r < end; ++r) {
+        auto i = GFT(r) - dst_offset;
+        auto mask = cmplt_epu32((__m256i) i, (__m256i) n);
+        auto v = _mm256_mask_i32gather_epi32(
+            _mm256_setzero_si256(), (const int *) src, row_index<W>((__m256i) (i + src_offset), lane0), mask, 4);
+        _mm256_maskstore_epi32((int *) &dst[r * W + lane0], mask, v);
+    }
+}
+
+
+template<size_t W>
+static void fill_n_rows(GFT dst[], GFTx8 const& dst_offset, GFTx8 n, GFTx8 const& value, int lane0) {
+    auto active = (GFTx8) (n != 0);
+    if (vec::is_zero(active))
+        return;
+
+    size_t begin = vec::min(dst_offset | ~active);
+    size_t end = vec::max((dst_offset + n) & active);
+
+    for (size_t r = begin; r < end; ++r) {
+        auto mask = cmplt_epu32((__m256i) (GFT(r) - dst_offset), (__m256i) n);
+        _mm256_maskstore_epi32((int *) &dst[r * W + lane0], mask, (__m256i) value);
+    }
+}
+
+
+template<>
+void vec::copy_n<GFTx8>(const GFTx8 src[], GFTx8 const& src_offset, GFTx8 n, GFTx8 dst[], GFTx8 const& dst_offset) {
+    copy_n_rows<8>((const GFT *) src, src_offset, n, (GFT *) dst, dst_offset, 0);
+}
+
+
+template<>
+void vec::fill_n<GFTx8>(GFTx8 dst[], GFTx8 const& dst_offset, GFTx8 n, GFTx8 const& value) {
+    fill_n_rows<8>((GFT *) dst, dst_offset, n, value, 0);
+}
+
+
+/**
+ * 16 lanes as two AVX2 vectors, for hosts without AVX-512. Every operation
+ * is applied to both halves.
+ */
+template<>
+GFTx8x2 ffrs::simd_gather_base::gather(const uint32_t vec[], GFTx8x2 const& i) {
+    return {gather(vec, i.lo), gather(vec, i.hi)};
+}
+
+
+template<>
+simd_mask_t vec::is_zero<GFTx8x2>(GFTx8x2 const& vec) {
+    auto any = (__m256i) (vec.lo | vec.hi);
+    return _mm256_testz_si256(any, any);
+}
+
+
+template<>
+void vec::assign_masked<GFTx8x2>(GFTx8x2& vec, GFTx8x2 const& value, GFTx8x2 const& condition) {
+    vec::assign_masked(vec.lo, value.lo, condition.lo);
+    vec::assign_masked(vec.hi, value.hi, condition.hi);
+}
+
+
+template<>
+void vec::copy_n_masked<GFTx8x2>(const GFTx8x2 src[], size_t n, GFTx8x2 dst[], GFTx8x2 const& condition) {
+    auto mask_lo = nonzero_mask(condition.lo);
+    auto mask_hi = nonzero_mask(condition.hi);
     for (size_t i = 0; i < n; i++) {
-        for (int j = 0; j < 8; j++)
-            if (condition[j])
-                dst[i][j] = src[i][j];
+        _mm256_maskstore_epi32((int *) &dst[i].lo, mask_lo, (__m256i) src[i].lo);
+        _mm256_maskstore_epi32((int *) &dst[i].hi, mask_hi, (__m256i) src[i].hi);
     }
 }
 
 
 template<>
-simd_mask_t vec::is_zero<GFTx8>(GFTx8 const& vec) {
-    // return std::all_of(
-    //     reinterpret_cast<const uint32_t *>(&vec),
-    //     reinterpret_cast<const uint32_t *>(&vec) + 8,
-    //     [](auto v) { return v == 0; }
-    // );
-    return _mm256_testz_si256((__m256i) vec, (__m256i) vec);
+GFTx8x2 vec::min<GFTx8x2>(GFTx8x2 const& a, GFTx8x2 const& b) {
+    return {vec::min(a.lo, b.lo), vec::min(a.hi, b.hi)};
+}
+
+
+template<>
+GFTx8x2 vec::max<GFTx8x2>(GFTx8x2 const& a, GFTx8x2 const& b) {
+    return {vec::max(a.lo, b.lo), vec::max(a.hi, b.hi)};
+}
+
+
+template<>
+GFT vec::min<GFTx8x2>(GFTx8x2 const& a) {
+    return vec::min(vec::min(a.lo, a.hi));
+}
+
+
+template<>
+GFT vec::max<GFTx8x2>(GFTx8x2 const& a) {
+    return vec::max(vec::max(a.lo, a.hi));
+}
+
+
+template<>
+GFTx8x2 vec::gather<GFTx8x2>(const GFTx8x2 src[], GFTx8x2 const& i) {
+    return {
+        (GFTx8) _mm256_i32gather_epi32((const int *) src, row_index<16>((__m256i) i.lo, 0), 4),
+        (GFTx8) _mm256_i32gather_epi32((const int *) src, row_index<16>((__m256i) i.hi, 8), 4),
+    };
 }
+
+
+template<>
+void vec::copy_n<GFTx8x2>(const GFTx8x2 src[], GFTx8x2 const& src_offset, GFTx8x2 n, GFTx8x2 dst[], GFTx8x2 const& dst_offset) {
+    copy_n_rows<16>((const GFT *) src, src_offset.lo, n.lo, (GFT *) dst, dst_offset.lo, 0);
+    copy_n_rows<16>((const GFT *) src, src_offset.hi, n.hi, (GFT *) dst, dst_offset.hi, 8);
+}
+
+
+template<>
+void vec::fill_n<GFTx8x2>(GFTx8x2 dst[], GFTx8x2 const& dst_offset, GFTx8x2 n, GFTx8x2 const& value) {
+    fill_n_rows<16>((GFT *) dst, dst_offset.lo, n.lo, value.lo, 0);
+    fill_n_rows<16>((GFT *) dst, dst_offset.hi, n.hi, value.hi, 8);
+}
+
+
+/**
+ * 8x8 transpose of 32-bit elements
+ */
+static inline void transpose8(__m256i rows[8]) {
+    __m256i t[8];
+    for (size_t i = 0; i < 8; i += 2) {
+        t[i] = _mm256_unpacklo_epi32(rows[i], rows[i + 1]);
+        t[i + 1] = _mm256_unpackhi_epi32(rows[i], rows[i + 1]);
+    }
+
+    // 128-bit lane k of u[4 * g + c]: rows 4g..4g+3 of column 4k + c
+    __m256i u[8];
+    for (size_t g = 0; g < 8; g += 4) {
+        u[g + 0] = _mm256_unpacklo_epi64(t[g], t[g + 2]);
+        u[g + 1] = _mm256_unpackhi_epi64(t[g], t[g + 2]);
+        u[g + 2] = _mm256_unpacklo_epi64(t[g + 1], t[g + 3]);
+        u[g + 3] = _mm256_unpackhi_epi64(t[g + 1], t[g + 3]);
+    }
+
+    for (size_t c = 0; c < 4; ++c) {
+        rows[c] = _mm256_permute2x128_si256(u[c], u[4 + c], 0x20);
+        rows[4 + c] = _mm256_permute2x128_si256(u[c], u[4 + c], 0x31);
+    }
+}
+
+
+static inline __m256i load_widen(const uint16_t src[]) {
+    return _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *) src));
+}
+
+
+static inline void store_narrow(uint16_t dst[], __m256i v) {
+    // keep the low 16 bits, packus would saturate
+    v = _mm256_and_si256(v, _mm256_set1_epi32(0xffff));
+    _mm_storeu_si128((__m128i *) dst, _mm_packus_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)));
+}
+
+
+/**
+ * Layout conversions for rows of W = 8 or 16 lanes, in 8x8 blocks when
+ * every lane is used
+ */
+template<size_t W>
+static void load_transposed_avx2(const uint16_t src[], size_t src_stride, GFT dst[], size_t rows, size_t cols) {
+    size_t r = 0;
+    if (cols == W) {
+        for (; r + 8 <= rows; r += 8) {
+            for (size_t j0 = 0; j0 < W; j0 += 8) {
+                __m256i v[8];
+                for (size_t j = 0; j < 8; ++j)
+                    v[j] = load_widen(&src[(j0 + j) * src_stride + r]);
+                transpose8(v);
+                for (size_t i = 0; i < 8; ++i)
+                    _mm256_storeu_si256((__m256i *) &dst[(r + i) * W + j0], v[i]);
+            }
+        }
+    }
+
+    for (size_t j = 0; j < cols; ++j)
+        for (size_t i = r; i < rows; ++i)
+            dst[i * W + j] = src[j * src_stride + i];
+}
+
+
+template<size_t W>
+static void load_stride_avx2(const uint16_t src[], size_t src_stride, GFT dst[], size_t rows, size_t cols) {
+    if (cols == W) {
+        for (size_t r = 0; r < rows; ++r)
+            for (size_t j0 = 0; j0 < W; j0 += 8)
+                _mm256_storeu_si256((__m256i *) &dst[r * W + j0], load_widen(&src[r * src_stride + j0]));
+        return;
+    }
+
+    for (size_t r = 0; r < rows; ++r)
+        for (size_t j = 0; j < cols; ++j)
+            dst[r * W + j] = src[r * src_stride + j];
+}
+
+
+template<size_t W>
+static void store_transposed_avx2(const GFT src[], uint16_t dst[], size_t dst_stride, size_t rows, size_t cols) {
+    size_t r = 0;
+    if (cols == W) {
+        for (; r + 8 <= rows; r += 8) {
+            for (size_t j0 = 0; j0 < W; j0 += 8) {
+                __m256i v[8];
+                for (size_t i = 0; i < 8; ++i)
+                    v[i] = _mm256_loadu_si256((const __m256i *) &src[(r + i) * W + j0]);
+                transpose8(v);
+                for (size_t j = 0; j < 8; ++j)
+                    store_narrow(&dst[(j0 + j) * dst_stride + r], v[j]);
+            }
+        }
+    }
+
+    for (size_t j = 0; j < cols; ++j)
+        for (size_t i = r; i < rows; ++i)
+            dst[j * dst_stride + i] = uint16_t(src[i * W + j]);
+}
+
+
+template<size_t W>
+static void store_transposed_avx2(const GFT src[], GFT dst[], size_t dst_stride, size_t rows, size_t cols) {
+    size_t r = 0;
+    if (cols == W) {
+        for (; r + 8 <= rows; r += 8) {
+            for (size_t j0 = 0; j0 < W; j0 += 8) {
+                __m256i v[8];
+                for (size_t i = 0; i < 8; ++i)
+                    v[i] = _mm256_loadu_si256((const __m256i *) &src[(r + i) * W + j0]);
+                transpose8(v);
+                for (size_t j = 0; j < 8; ++j)
+                    _mm256_storeu_si256((__m256i *) &dst[(j0 + j) * dst_stride + r], v[j]);
+            }
+        }
+    }
+
+    for (size_t j = 0; j < cols; ++j)
+        for (size_t i = r; i < rows; ++i)
+            dst[j * dst_stride + i] = src[i * W + j];
+}
+
+
+template<size_t W>
+static void store_stride_avx2(const GFT src[], uint16_t dst[], size_t dst_stride, size_t rows, size_t cols) {
+    if (cols == W) {
+        for (size_t r = 0; r < rows; ++r)
+            for (size_t j0 = 0; j0 < W; j0 += 8)
+                store_narrow(&dst[r * dst_stride + j0], _mm256_loadu_si256((const __m256i *) &src[r * W + j0]));
+        return;
+    }
+
+    for (size_t r = 0; r < rows; ++r)
+        for (size_t j = 0; j < cols; ++j)
+            dst[r * dst_stride + j] = uint16_t(src[r * W + j]);
+}
+
+
+/**
+ * 32-bit gathers of each symbol and the one after it, which may be past the end of `src`
+ * on the last row: that row is loaded per symbol. There are no 16-bit scatters, stores
+ * use the portable vec::store_cols.
+ */
+template<size_t W>
+static void load_cols_avx2(const uint16_t src[], size_t src_stride, const size_t col[], GFT dst[], size_t rows, size_t cols) {
+    size_t r = 0;
+    if (cols == W) {
+        __m256i idx[W / 8];
+        for (size_t j0 = 0; j0 < W; j0 += 8) {
+            alignas(32) int32_t i32[8];
+            for (size_t j = 0; j < 8; ++j)
+                i32[j] = int32_t(col[j0 + j]);
+            idx[j0 / 8] = _mm256_load_si256((const __m256i *) i32);
+        }
+
+        const __m256i mask = _mm256_set1_epi32(0xffff);
+        for (; r + 1 < rows; ++r) {
+            auto row = (const int *) &src[r * src_stride];
+            for (size_t j0 = 0; j0 < W; j0 += 8)
+                _mm256_storeu_si256((__m256i *) &dst[r * W + j0], _mm256_and_si256(_mm256_i32gather_epi32(row, idx[j0 / 8], 2), mask));
+        }
+    }
+
+    for (; r < rows; ++r)
+        for (size_t j = 0; j < cols; ++j)
+            dst[r * W + j] = src[r * src_stride + col[j]];
+}
+
+
+template<>
+void vec::load_transposed<8, uint16_t>(const uint16_t src[], size_t src_stride, GFT dst[], size_t rows, size_t cols) {
+    load_transposed_avx2<8>(src, src_stride, dst, rows, cols);
+}
+
+
+template<>
+void vec::load_stride<8, uint16_t>(const uint16_t src[], size_t src_stride, GFT dst[], size_t rows, size_t cols) {
+    load_stride_avx2<8>(src, src_stride, dst, rows, cols);
+}
+
+
+template<>
+void vec::store_transposed<8, uint16_t>(const GFT src[], uint16_t dst[], size_t dst_stride, size_t rows, size_t cols) {
+    store_transposed_avx2<8>(src, dst, dst_stride, rows, cols);
+}
+
+
+template<>
+void vec::store_transposed<8, GFT>(const GFT src[], GFT dst[], size_t dst_stride, size_t rows, size_t cols) {
+    store_transposed_avx2<8>(src, dst, dst_stride, rows, cols);
+}
+
+
+template<>
+void vec::store_stride<8, uint16_t>(const GFT src[], uint16_t dst[], size_t dst_stride, size_t rows, size_t cols) {
+    store_stride_avx2<8>(src, dst, dst_stride, rows, cols);
+}
+
+
+const vec::layout_kernels vec::layout_avx2 = {
+    load_transposed_avx2<8>,
+    load_stride_avx2<8>,
+    store_transposed_avx2<8>,
+    store_transposed_avx2<8>,
+    store_stride_avx2<8>,
+    load_cols_avx2<8>,
+    vec::store_cols<8, uint16_t>,
+};
+
+const vec::layout_kernels vec::layout_avx2x2 = {
+    load_transposed_avx2<16>,
+    load_stride_avx2<16>,
+    store_transposed_avx2<16>,
+    store_transposed_avx2<16>,
+    store_stride_avx2<16>,
+    load_cols_avx2<16>,
+    vec::store_cols<16, uint16_t>,
+};
+
+RSI16V_IMPL_INSTANTIATE(16, GFTx8x2)
+
+
+/**
+ * 16 lanes, the 65536 mask is a second vector of 0/0xffff lanes
+ */
+template<>
+struct epi16<16> {
+    struct type {
+        __m256i x;
+        __m256i e;
+    };
+
+    static inline __m256i ones() {
+        return _mm256_set1_epi16(-1);
+    }
+
+    // a >= b, unsigned
+    static inline __m256i ge(__m256i a, __m256i b) {
+        return _mm256_cmpeq_epi16(_mm256_max_epu16(a, b), a);
+    }
+
+    static inline type load(const uint16_t src[]) {
+        return {_mm256_loadu_si256((const __m256i *) src), _mm256_setzero_si256()};
+    }
+
+    static inline void store(uint16_t dst[], type const& a) {
+        _mm256_storeu_si256((__m256i *) dst, a.x);
+    }
+
+    static inline type zero() {
+        return {_mm256_setzero_si256(), _mm256_setzero_si256()};
+    }
+
+    static inline type add(type const& a, type const& b) {
+        // t = a + b - 65536 * (carry + ea + eb), at most one of them unless ea and eb
+        auto t = _mm256_add_epi16(a.x, b.x);
+        auto no_carry = ge(t, a.x);
+        auto r = _mm256_add_epi16(t, _mm256_sub_epi16(_mm256_add_epi16(_mm256_add_epi16(a.e, b.e), ones()), no_carry));
+        auto no_borrow = ge(t, r);
+        return {
+            _mm256_add_epi16(_mm256_sub_epi16(r, ones()), no_borrow),
+            _mm256_andnot_si256(no_borrow, _mm256_cmpeq_epi16(r, ones()))
+        };
+    }
+
+    static inline type sub(type const& a, type const& b) {
+        auto t = _mm256_sub_epi16(a.x, b.x);
+        auto no_borrow = ge(a.x, b.x);
+        auto r = _mm256_sub_epi16(_mm256_add_epi16(_mm256_sub_epi16(_mm256_add_epi16(t, no_borrow), ones()), a.e), b.e);
+        // 65536 - 0, x - 65536 == x + 1
+        auto ea = _mm256_andnot_si256(b.e, _mm256_and_si256(a.e, _mm256_cmpeq_epi16(b.x, _mm256_setzero_si256())));
+        auto eb = _mm256_and_si256(_mm256_cmpeq_epi16(r, _mm256_setzero_si256()), _mm256_cmpeq_epi16(t, ones()));
+        return {_mm256_andnot_si256(ea, r), _mm256_or_si256(ea, eb)};
+    }
+
+    static inline type neg(type const& a) {
+        auto zero = _mm256_cmpeq_epi16(a.x, _mm256_setzero_si256());
+        auto x = _mm256_andnot_si256(zero, _mm256_sub_epi16(_mm256_set1_epi16(1), a.x));
+        return {_mm256_sub_epi16(x, a.e), _mm256_cmpeq_epi16(a.x, _mm256_set1_epi16(1))};
+    }
+
+    static inline type mul(type const& a, epi16_factor const& f) {
+        if (f.neg)
+            return neg(a);
+
+        // lo - hi with 2^16 == -1, + 65537 on borrow
+        auto w = _mm256_set1_epi16(int16_t(f.w));
+        auto lo = _mm256_mullo_epi16(a.x, w);
+        auto hi = _mm256_mulhi_epu16(a.x, w);
+        auto d = _mm256_sub_epi16(lo, hi);
+        auto no_borrow = ge(lo, hi);
+        auto x = _mm256_add_epi16(_mm256_sub_epi16(d, ones()), no_borrow);
+        auto e = _mm256_andnot_si256(no_borrow, _mm256_cmpeq_epi16(d, ones()));
+
+        // 65536 * w == -w
+        x = _mm256_or_si256(x, _mm256_and_si256(a.e, _mm256_set1_epi16(int16_t(f.neg_w))));
+        if (f.neg_e)
+            e = _mm256_or_si256(e, a.e);
+        return {x, e};
+    }
+};
+
+RSI16E_IMPL_INSTANTIATE(16)
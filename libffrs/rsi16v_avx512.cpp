@@ -35,35 +35,101 @@ GFTx16 ffrs::simd_gather_base::gather(const uint32_t vec[], GFTx16 const& i) {
 }
 
 
+/**
+ * Element offsets of `src[row[j]][j]` for 32-bit gathers
+ */
+static inline __m512i row_index(__m512i row) {
+    return _mm512_add_epi32(
+        _mm512_slli_epi32(row, 4),
+        _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15)
+    );
+}
+
+
 template<>
 void vec::assign_masked<GFTx16>(GFTx16& vec, GFTx16 const& value, GFTx16 const& condition) {
-    for (int j = 0; j < 16; j++)
-        if (condition[j] || true)
-            vec[j] = value[j];
-
-    // auto mask = _mm512_movepi32_mask((__m512i) condition);
-    // vec = (GFTx16) _mm512_mask_mov_epi32(
-    //     (__m512i) vec,
-    //     mask,
-    //     (__m512i) value
-    // );
+    auto mask = _mm512_test_epi32_mask((__m512i) condition, (__m512i) condition);
+    vec = (GFTx16) _mm512_mask_mov_epi32(
+        (__m512i) vec,
+        mask,
+        (__m512i) value
+    );
 }
 
 
 template<>
 void vec::copy_n_masked<GFTx16>(const GFTx16 src[], size_t n, GFTx16 dst[], GFTx16 const& condition) {
-    // for (size_t i = 0; i < n; i++) {
-    //     for (int j = 0; j < 16; j++)
-    //         if (condition[j])
-    //             dst[i][j] = src[i][j];
-    // }
-    auto mask = _mm512_movepi32_mask((__m512i) condition);
-    for (size_t i = 0; i < n; i++) {
-        dst[i] = (GFTx16) _mm512_mask_mov_epi32(
-            (__m512i) dst[i],
-            mask,
-            (__m512i) src[i]
-        );
+    auto mask = _mm512_test_epi32_mask((__m512i) condition, (__m512i) condition);
+    for (size_t i = 0; i < n; i++)
+        _mm512_mask_store_epi32(&dst[i], mask, (__m512i) src[i]);
+}
+
+
+template<>
+GFTx16 vec::min<GFTx16>(GFTx16 const& a, GFTx16 const& b) {
+    return (GFTx16) _mm512_min_epu32((__m512i) a, (__m512i) b);
+}
+
+
+template<>
+GFTx16 vec::max<GFTx16>(GFTx16 const& a, GFTx16 const& b) {
+    return (GFTx16) _mm512_max_epu32((__m512i) a, (__m512i) b);
+}
+
+
+template<>
+GFT vec::min<GFTx16>(GFTx16 const& a) {
+    return _mm512_reduce_min_epu32((__m512i) a);
+}
+
+
+template<>
+GFT vec::max<GFTx16>(GFTx16 const& a) {
+    return _mm512_reduce_max_epu32((__m512i) a);
+}
+
+
+template<>
+GFTx16 vec::gather<GFTx16>(const GFTx16 src[], GFTx16 const& i) {
+    return (GFTx16) _mm512_i32gather_epi32(row_index((__m512i) i), src, 4);
+}
+
+
+/**
+ * Iterate over destination rows so that every store is a full row: lane j
+ * of row r is written when r - dst_offset[j] < n[j]
+ */
+template<>
+void vec::copy_n<GFTx16>(const GFTx16 src[], GFTx16 const& src_offset, GFTx16 n, GFTx16 dst[], GFTx16 const& dst_offset) {
+    auto active = _mm512_test_epi32_mask((__m512i) n, (__m512i) n);
+    if (!active)
+        return;
+
+    size_t begin = _mm512_mask_reduce_min_epu32(active, (__m512i) dst_offset);
+    size_t end = _mm512_mask_reduce_max_epu32(active, (__m512i) (dst_offset + n));
+
+    for (size_t r = begin; r < end; ++r) {
+        auto i = GFT(r) - dst_offset;
+        auto mask = _mm512_cmplt_epu32_mask((__m512i) i, (__m512i) n);
+        auto v = _mm512_mask_i32gather_epi32(
+            _mm512_setzero_si512(), mask, row_index((__m512i) (i + src_offset)), src, 4);
+        _mm512_mask_store_epi32(&dst[r], mask, v);
+    }
+}
+
+
+template<>
+void vec::fill_n<GFTx16>(GFTx16 dst[], GFTx16 const& dst_offset, GFTx16 n, GFTx16 const& value) {
+    auto active = _mm512_test_epi32_mask((__m512i) n, (__m512i) n);
+    if (!active)
+        return;
+
+    size_t begin = _mm512_mask_reduce_min_epu32(active, (__m512i) dst_offset);
+    size_t end = _mm512_mask_reduce_max_epu32(active, (__m512i) (dst_offset + n));
+
+    for (size_t r = begin; r < end; ++r) {
+        auto mask = _mm512_cmplt_epu32_mask((__m512i) (GFT(r) - dst_offset), (__m512i) n);
+        _mm512_mask_store_epi32(&dst[r], mask, (__m512i) value);
     }
 }
 
@@ -78,3 +144,167 @@ simd_mask_t vec::is_zero<GFTx16>(GFTx16 const& vec) {
     // return (_mm512_cmpeq_epi32_mask((__m512i) vec, __m512i{0}) == 0xffff);
     return _mm512_test_epi32_mask((__m512i) vec, (__m512i) vec) == 0;
 }
+
+
+/**
+ * 16x16 transpose of 32-bit elements
+ */
+static inline void transpose16(__m512i rows[16]) {
+    __m512i t[16];
+    for (size_t i = 0; i < 16; i += 2) {
+        t[i] = _mm512_unpacklo_epi32(rows[i], rows[i + 1]);
+        t[i + 1] = _mm512_unpackhi_epi32(rows[i], rows[i + 1]);
+    }
+
+    // 128-bit lane k of u[4 * g + c]: rows 4g..4g+3 of column 4k + c
+    __m512i u[16];
+    for (size_t g = 0; g < 16; g += 4) {
+        u[g + 0] = _mm512_unpacklo_epi64(t[g], t[g + 2]);
+        u[g + 1] = _mm512_unpackhi_epi64(t[g], t[g + 2]);
+        u[g + 2] = _mm512_unpacklo_epi64(t[g + 1], t[g + 3]);
+        u[g + 3] = _mm512_unpackhi_epi64(t[g + 1], t[g + 3]);
+    }
+
+    for (size_t c = 0; c < 4; ++c) {
+        auto x01 = _mm512_shuffle_i32x4(u[c], u[4 + c], 0x88);
+        auto y01 = _mm512_shuffle_i32x4(u[c], u[4 + c], 0xdd);
+        auto x23 = _mm512_shuffle_i32x4(u[8 + c], u[12 + c], 0x88);
+        auto y23 = _mm512_shuffle_i32x4(u[8 + c], u[12 + c], 0xdd);
+        rows[c] = _mm512_shuffle_i32x4(x01, x23, 0x88);
+        rows[4 + c] = _mm512_shuffle_i32x4(y01, y23, 0x88);
+        rows[8 + c] = _mm512_shuffle_i32x4(x01, x23, 0xdd);
+        rows[12 + c] = _mm512_shuffle_i32x4(y01, y23, 0xdd);
+    }
+}
+
+
+static inline __m512i load_widen(const uint16_t src[]) {
+    return _mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i *) src));
+}
+
+
+static inline void store_narrow(uint16_t dst[], __m512i v) {
+    _mm256_storeu_si256((__m256i *) dst, _mm512_cvtepi32_epi16(v));
+}
+
+
+template<>
+void vec::load_transposed<16, uint16_t>(const uint16_t src[], size_t src_stride, GFT dst[], size_t rows, size_t cols) {
+    size_t r = 0;
+    if (cols == 16) {
+        for (; r + 16 <= rows; r += 16) {
+            __m512i v[16];
+            for (size_t j = 0; j < 16; ++j)
+                v[j] = load_widen(&src[j * src_stride + r]);
+            transpose16(v);
+            for (size_t i = 0; i < 16; ++i)
+                _mm512_storeu_si512(&dst[(r + i) * 16], v[i]);
+        }
+    }
+
+    for (size_t j = 0; j < cols; ++j)
+        for (size_t i = r; i < rows; ++i)
+            dst[i * 16 + j] = src[j * src_stride + i];
+}
+
+
+template<>
+void vec::load_stride<16, uint16_t>(const uint16_t src[], size_t src_stride, GFT dst[], size_t rows, size_t cols) {
+    if (cols == 16) {
+        for (size_t r = 0; r < rows; ++r)
+            _mm512_storeu_si512(&dst[r * 16], load_widen(&src[r * src_stride]));
+        return;
+    }
+
+    for (size_t r = 0; r < rows; ++r)
+        for (size_t j = 0; j < cols; ++j)
+            dst[r * 16 + j] = src[r * src_stride + j];
+}
+
+
+template<>
+void vec::store_transposed<16, uint16_t>(const GFT src[], uint16_t dst[], size_t dst_stride, size_t rows, size_t cols) {
+    size_t r = 0;
+    if (cols == 16) {
+        for (; r + 16 <= rows; r += 16) {
+            __m512i v[16];
+            for (size_t i = 0; i < 16; ++i)
+                v[i] = _mm512_loadu_si512(&src[(r + i) * 16]);
+            transpose16(v);
+            for (size_t j = 0; j < 16; ++j)
+                store_narrow(&dst[j * dst_stride + r], v[j]);
+        }
+    }
+
+    for (size_t j = 0; j < cols; ++j)
+        for (size_t i = r; i < rows; ++i)
+            dst[j * dst_stride + i] = uint16_t(src[i * 16 + j]);
+}
+
+
+template<>
+void vec::store_transposed<16, GFT>(const GFT src[], GFT dst[], size_t dst_stride, size_t rows, size_t cols) {
+    size_t r = 0;
+    if (cols == 16) {
+        for (; r + 16 <= rows; r += 16) {
+            __m512i v[16];
+            for (size_t i = 0; i < 16; ++i)
+                v[i] = _mm512_loadu_si512(&src[(r + i) * 16]);
+            transpose16(v);
+            for (size_t j = 0; j < 16; ++j)
+                _mm512_storeu_si512(&dst[j * dst_stride + r], v[j]);
+        }
+    }
+
+    for (size_t j = 0; j < cols; ++j)
+        for (size_t i = r; i < rows; ++i)
+            dst[j * dst_stride + i] = src[i * 16 + j];
+}
+
+
+template<>
+void vec::store_stride<16, uint16_t>(const GFT src[], uint16_t dst[], size_t dst_stride, size_t rows, size_t cols) {
+    if (cols == 16) {
+        for (size_t r = 0; r < rows; ++r)
+            store_narrow(&dst[r * dst_stride], _mm512_loadu_si512(&src[r * 16]));
+        return;
+    }
+
+    for (size_t r = 0; r < rows; ++r)
+        for (size_t j = 0; j < cols; ++j)
+            dst[r * dst_stride + j] = uint16_t(src[r * 16 + j]);
+}
+
+
+/**
+ * Same as load_cols_avx2: the last row is loaded per symbol, the portable vec::store_cols
+ * stores
+ */
+static void load_cols_avx512(const uint16_t src[], size_t src_stride, const size_t col[], GFT dst[], size_t rows, size_t cols) {
+    size_t r = 0;
+    if (cols == 16) {
+        alignas(64) int32_t i32[16];
+        for (size_t j = 0; j < 16; ++j)
+            i32[j] = int32_t(col[j]);
+        const __m512i idx = _mm512_load_si512(i32);
+
+        const __m512i mask = _mm512_set1_epi32(0xffff);
+        for (; r + 1 < rows; ++r)
+            _mm512_storeu_si512(&dst[r * 16], _mm512_and_si512(_mm512_i32gather_epi32(idx, &src[r * src_stride], 2), mask));
+    }
+
+    for (; r < rows; ++r)
+        for (size_t j = 0; j < cols; ++j)
+            dst[r * 16 + j] = src[r * src_stride + col[j]];
+}
+
+
+const vec::layout_kernels vec::layout_avx512f = {
+    &vec::load_transposed<16, uint16_t>,
+    &vec::load_stride<16, uint16_t>,
+    &vec::store_transposed<16, uint16_t>,
+    &vec::store_transposed<16, GFT>,
+    &vec::store_stride<16, uint16_t>,
+    load_cols_avx512,
+    &vec::store_cols<16, uint16_t>,
+};
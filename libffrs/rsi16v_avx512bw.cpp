@@ -0,0 +1,92 @@
+/**************************************************************************
+ * rsi16v_avx512bw.cpp
+ *
+ * Copyright 2026 Gabriel Machado
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************/
+
+#include <cstdint>
+#include <immintrin.h>
+
+#include "rsi16e_impl.hpp"
+
+
+/**
+ * 32 lanes, the 65536 lanes are a mask register
+ */
+template<>
+struct epi16<32> {
+    struct type {
+        __m512i x;
+        __mmask32 e;
+    };
+
+    static inline __m512i one() {
+        return _mm512_set1_epi16(1);
+    }
+
+    static inline type load(const uint16_t src[]) {
+        return {_mm512_loadu_si512(src), 0};
+    }
+
+    static inline void store(uint16_t dst[], type const& a) {
+        _mm512_storeu_si512(dst, a.x);
+    }
+
+    static inline type zero() {
+        return {_mm512_setzero_si512(), 0};
+    }
+
+    static inline type add(type const& a, type const& b) {
+        // a + b - 65536 is a + b - 1, 65536 + 65536 is 0xffff
+        auto t = _mm512_add_epi16(a.x, b.x);
+        __mmask32 k = _mm512_cmplt_epu16_mask(t, a.x) | a.e | b.e;
+        __mmask32 e = _mm512_mask_cmpeq_epi16_mask(k & ~(a.e & b.e), t, _mm512_setzero_si512());
+        return {_mm512_mask_sub_epi16(t, k & ~e, t, one()), e};
+    }
+
+    static inline type sub(type const& a, type const& b) {
+        // a - b + 65536 is a - b + 1, 65536 - b is -b unless b == 0
+        auto t = _mm512_sub_epi16(a.x, b.x);
+        __mmask32 borrow = _mm512_cmplt_epu16_mask(a.x, b.x);
+        __mmask32 inc = (borrow | b.e) & ~a.e;
+        __mmask32 e = _mm512_mask_cmpeq_epi16_mask(inc, t, _mm512_set1_epi16(-1)) | (a.e & ~borrow & ~b.e);
+        return {_mm512_mask_add_epi16(t, inc, t, one()), e};
+    }
+
+    static inline type neg(type const& a) {
+        auto x = _mm512_maskz_sub_epi16(_mm512_test_epi16_mask(a.x, a.x), one(), a.x);
+        return {_mm512_mask_mov_epi16(x, a.e, one()), _mm512_cmpeq_epi16_mask(a.x, one())};
+    }
+
+    static inline type mul(type const& a, epi16_factor const& f) {
+        if (f.neg)
+            return neg(a);
+
+        // lo - hi with 2^16 == -1, + 65537 on borrow
+        auto w = _mm512_set1_epi16(int16_t(f.w));
+        auto lo = _mm512_mullo_epi16(a.x, w);
+        auto hi = _mm512_mulhi_epu16(a.x, w);
+        auto d = _mm512_sub_epi16(lo, hi);
+        __mmask32 borrow = _mm512_cmplt_epu16_mask(lo, hi);
+        auto x = _mm512_mask_add_epi16(d, borrow, d, one());
+        __mmask32 e = _mm512_mask_cmpeq_epi16_mask(borrow, d, _mm512_set1_epi16(-1));
+
+        // 65536 * w == -w
+        x = _mm512_mask_mov_epi16(x, a.e, _mm512_set1_epi16(int16_t(f.neg_w)));
+        return {x, f.neg_e ? __mmask32(e | a.e) : e};
+    }
+};
+
+RSI16E_IMPL_INSTANTIATE(32)
@@ -31,7 +31,7 @@
 
 #include <pybind11/stl.h>
 
-// #define FFRS_CHECK_BOUNDS
+// FFRS_CHECK_BOUNDS: checked sizes and residue bounds, cmake -DFFRS_CHECK_BOUNDS=ON
 
 
 #ifdef FFRS_CHECK_BOUNDS
@@ -65,10 +65,11 @@
 #endif
 
 
-template<size_t W>
-RSi16v<W>::RSi16v(NTT const& ntt, size_t block_len, size_t ecc_len):
+template<size_t W, typename V>
+RSi16v<W, V>::RSi16v(NTT const& ntt, size_t block_len, size_t ecc_len, vec::layout_kernels const& layout):
     gf(ntt.gf),
     ntt(ntt),
+    layout(layout),
     root(ntt.root),
     ntt_len(ntt.ntt_len),
     block_len(block_len),
@@ -79,55 +80,108 @@ RSi16v<W>::RSi16v(NTT const& ntt, size_t block_len, size_t ecc_len):
     _ecc_mix_i.resize(ecc_len);
     auto ecc_mix_w = *reinterpret_cast<const ::GFT *>(&ntt._roots_ntt[ntt.rbo(block_len - ecc_len)]);
     auto ecc_mix_w_i = gf.inv(ecc_mix_w);
-    for (size_t i = 0; i < ecc_len; ++i) {
-        _ecc_mix[i] = gf.neg(gf.div(gf.pow(ecc_mix_w_i, i), ecc_len));
-        _ecc_mix_i[i] = gf.neg(gf.pow(ecc_mix_w, i));
-    }
+    // -w^-i / ecc_len, -w^i
+    ntt.powers(ecc_mix_w_i, gf.neg(ntt.ecc_len_i), &_ecc_mix[0], ecc_len);
+    ntt.powers(ecc_mix_w, gf.neg(1), &_ecc_mix_i[0], ecc_len);
+    _ecc_mix_q = ntt.shoup_q(_ecc_mix);
 }
 
 
-template<size_t W>
-RSi16v<W>::~RSi16v() { }
+template<size_t W, typename V>
+RSi16v<W, V>::~RSi16v() { }
 
 
-template<size_t W>
-void RSi16v<W>::_encode(GFT *const block) const {
-    ntt.pntt_message_residue(&block[0]);
-    _mix_ecc_residue(&block[0]);
+template<size_t W, typename V>
+void RSi16v<W, V>::_encode(GFT *const block) const {
+    auto bound = ntt.pntt_message_residue(&block[0]);
+    _mix_ecc_residue(&block[0], bound);
 }
 
 
-template<size_t W>
-void RSi16v<W>::_mix_ecc(GFT *const ecc) const {
-    for (size_t j = 0; j < ecc_len; ++j)
-        ecc[j] = gf.mul(ecc[j], _ecc_mix[j]);
+/**
+ * The message is widened one sub-block at a time, so the block is never
+ * copied as a whole to W-wide storage
+ */
+template<size_t W, typename V>
+template<typename Src>
+void RSi16v<W, V>::_encode(const Src src[], size_t row_stride, size_t col_stride, size_t cols, GFT *const ecc, GFT *const temp_ecc) const {
+    auto bound = ntt.pntt_message_residue([&](size_t i, GFT *const buf) {
+        auto sub_block = &src[i * ecc_len * row_stride];
+        auto out = reinterpret_cast<::GFT *>(&buf[0]);
+
+        if (cols < W)
+            std::fill_n(&buf[0], ecc_len, GFT{0});
+
+        if (col_stride == 1 && cols == W) {
+            for (size_t r = 0; r < ecc_len; ++r) {
+                // one cache line per row when interleaved
+                __builtin_prefetch(&sub_block[(r + 16) * row_stride]);
+                for (size_t j = 0; j < W; ++j)
+                    out[r * W + j] = sub_block[r * row_stride + j];
+            }
+        } else if (row_stride == 1 && std::is_same_v<Src, uint16_t>) {
+            // called through the table directly: a vec:: template keyed on W alone would be
+            // instantiated by both x16 variants with different instruction sets
+            if constexpr (std::is_same_v<Src, uint16_t>)
+                layout.load_transposed(&sub_block[0], col_stride, &out[0], ecc_len, cols);
+        } else if (row_stride == 1) {
+            for (size_t j = 0; j < cols; ++j)
+                for (size_t r = 0; r < ecc_len; ++r)
+                    out[r * W + j] = sub_block[j * col_stride + r];
+        } else {
+            for (size_t r = 0; r < ecc_len; ++r)
+                for (size_t j = 0; j < cols; ++j)
+                    out[r * W + j] = sub_block[r * row_stride + j * col_stride];
+        }
+        return &buf[0];
+    }, &ecc[0], &temp_ecc[0]);
 
-    ntt.gs_butterfly(&ntt._roots_i_ecc[0], &ecc[0], ecc_len, ecc_len);
+    _mix_ecc_residue(&ecc[0], bound);
 }
 
-template<size_t W>
-void RSi16v<W>::_mix_ecc_residue(GFT *const ecc) const {
-    for (size_t j = 0; j < ecc_len; ++j)
-        ecc[j] = gf.mul(gf.mod_p(ecc[j]), _ecc_mix[j]);
-        // ecc[j] = gf.mul_residue(gf.mod_p(ecc[j]), _ecc_mix[j]);
 
-    ntt.gs_butterfly(&ntt._roots_i_ecc[0], &ecc[0], ecc_len, ecc_len);
-    // ntt.gs_butterfly_residue(&ntt._roots_i_ecc[0], &ecc[0], ecc_len, ecc_len);
+/**
+ * Syndromes of a full block, returned in block[0:ecc_len]
+ */
+template<size_t W, typename V>
+void RSi16v<W, V>::_synd(GFT *const block) const {
+    ntt.pntt(&block[0]);
+}
 
-    // for (size_t j = 0; j < ecc_len; ++j)
-    //     ecc[j] = gf.mod_p(ecc[j]);
+
+template<size_t W, typename V>
+void RSi16v<W, V>::_mix_ecc(GFT *const ecc) const {
+    _mix_ecc_residue(&ecc[0], 0x10001);
+}
+
+/**
+ * ecc: residues with |x| < bound, canonical output
+ */
+template<size_t W, typename V>
+void RSi16v<W, V>::_mix_ecc_residue(GFT *const ecc, uint64_t bound) const {
+    ntt.ecc_mix_residue(&ecc[0], &_ecc_mix[0], &_ecc_mix_q[0], bound);
 }
 
 
-template<size_t W>
-RepairStatus RSi16v<W>::_repair(GFT *const block, GFT *const temp_ntt1_ecc6) const {
+template<size_t W, typename V>
+RepairStatus RSi16v<W, V>::_repair(GFT *const block, GFT *const temp_ecc6) const {
     r_print("repair unknown >");
-    // temp_ntt1_ecc6 = ntt_len + ecc_len * 6
+    // temp_ecc6 = ecc_len * 6
 
     // compute synds
-    auto synds = &temp_ntt1_ecc6[ecc_len * 0];
-    std::copy_n(&block[0], block_len, &synds[0]);
-    ntt.pntt(&synds[0]);
+    auto synds = &temp_ecc6[ecc_len * 0];
+    ntt.pntt(&block[0], &synds[0], &temp_ecc6[ecc_len * 1]);
+
+    return _repair_synd(&block[0], &temp_ecc6[0]);
+}
+
+
+/**
+ * temp_ecc6[0:ecc_len]: syndromes of block
+ */
+template<size_t W, typename V>
+RepairStatus RSi16v<W, V>::_repair_synd(GFT *const block, GFT *const temp_ecc6) const {
+    auto synds = &temp_ecc6[ecc_len * 0];
     r_print_vec("synds", synds, ecc_len);
 
     // stop if all synds are zero
@@ -139,8 +193,8 @@ RepairStatus RSi16v<W>::_repair(GFT *const block, GFT *const temp_ntt1_ecc6) con
     // init evaluator_poly with synds
     auto evaluator_poly = &synds[0];
 
-    auto locator_poly = &temp_ntt1_ecc6[ecc_len * 1];
-    auto locator_poly_len = _sugiyama(&locator_poly[0], &evaluator_poly[0], &temp_ntt1_ecc6[ecc_len * 2]);
+    auto locator_poly = &temp_ecc6[ecc_len * 1];
+    auto locator_poly_len = _sugiyama(&locator_poly[0], &evaluator_poly[0], &temp_ecc6[ecc_len * 2]);
     r_print_vec("locator_poly", locator_poly, ecc_len);
     r_print_vec("locator_poly_len", &locator_poly_len, 1);
     r_print_vec("evaluator_poly", evaluator_poly, ecc_len);
@@ -149,13 +203,13 @@ RepairStatus RSi16v<W>::_repair(GFT *const block, GFT *const temp_ntt1_ecc6) con
     if constexpr (!std::is_integral_v<GFT>)
         evaluator_poly_len &= (locator_poly_len != 0);
 
-    auto locator_poly_deriv = &temp_ntt1_ecc6[ecc_len * 2];
+    auto locator_poly_deriv = &temp_ecc6[ecc_len * 2];
     std::copy_n(&locator_poly[0], ecc_len, &locator_poly_deriv[0]);
     _deriv(locator_poly_deriv, ecc_len);
     r_print_vec("locator_poly_deriv", locator_poly_deriv, ecc_len);
     auto locator_poly_deriv_len = vec::poly::len(&locator_poly_deriv[0], ecc_len);
 
-    auto roots = &temp_ntt1_ecc6[ecc_len * 3];
+    auto roots = &temp_ecc6[ecc_len * 3];
     auto res = _find_roots_ntt(
         &block[0],
         &locator_poly[0], locator_poly_len,
@@ -168,15 +222,14 @@ RepairStatus RSi16v<W>::_repair(GFT *const block, GFT *const temp_ntt1_ecc6) con
 }
 
 
-template<size_t W>
-RepairStatus RSi16v<W>::_repair(GFT *const block, const size_t *const error_pos_rbo, size_t error_count, GFT *const temp_ntt1_ecc6) const {
+template<size_t W, typename V>
+RepairStatus RSi16v<W, V>::_repair(GFT *const block, const size_t *const error_pos_rbo, size_t error_count, GFT *const temp_ecc6) const {
     r_print("repair known >");
-    // temp_ntt1_ecc6 = ntt_len + ecc_len * 6
+    // temp_ecc6 = ecc_len * 6
 
     // compute synds
-    auto synds = &temp_ntt1_ecc6[ecc_len * 0];
-    std::copy_n(&block[0], block_len, &synds[0]);
-    ntt.pntt(&synds[0]);
+    auto synds = &temp_ecc6[ecc_len * 0];
+    ntt.pntt(&block[0], &synds[0], &temp_ecc6[ecc_len * 1]);
     r_print_vec("synds", synds, ecc_len);
 
     // stop if all synds are zero
@@ -187,18 +240,18 @@ RepairStatus RSi16v<W>::_repair(GFT *const block, const size_t *const error_pos_
 
     // init evaluator_poly with synds
     auto evaluator_poly = &synds[0];  // size = ecc_len * 2
-    auto locator_poly = &temp_ntt1_ecc6[ecc_len * 2];  // size = ecc_len * 2
+    auto locator_poly = &temp_ecc6[ecc_len * 2];  // size = ecc_len * 2
     _error_locator(&error_pos_rbo[0], error_count, &locator_poly[0]);
     r_print_vec("locator_poly", locator_poly, ecc_len);
 
     auto locator_poly_deg = error_count;
     r_print_vec("locator_poly_deg", &locator_poly_deg, 1);
 
-    _error_evaluator(&locator_poly[0], locator_poly_deg, &evaluator_poly[0], &temp_ntt1_ecc6[ecc_len * 4]);
+    _error_evaluator(&locator_poly[0], locator_poly_deg, &evaluator_poly[0], &temp_ecc6[ecc_len * 4]);
     r_print_vec("evaluator_poly", evaluator_poly, ecc_len);
 
     auto evaluator_poly_len = ecc_len;
-    auto locator_poly_deriv = &temp_ntt1_ecc6[ecc_len * 1];
+    auto locator_poly_deriv = &temp_ecc6[ecc_len * 1];
 
     // TODO: remove copy_n and add dst array to _deriv
     std::copy_n(&locator_poly[0], ecc_len, &locator_poly_deriv[0]);
@@ -214,12 +267,12 @@ RepairStatus RSi16v<W>::_repair(GFT *const block, const size_t *const error_pos_
         auto pos = ntt.rbo(pos_rbo);
         r_print("error pos:", pos);
 
-        ::GFT x = ntt._roots_ntt[pos_rbo];
+        GFT x_inv = GFT{} + ntt._roots_i_ntt[pos_rbo];
 
         GFT error = _forney(
             &locator_poly_deriv[0], locator_poly_deriv_len_max,
             &evaluator_poly[0], evaluator_poly_len,
-            x
+            x_inv
         );
 
         r_print_vec("error", &error, 1);
@@ -231,48 +284,291 @@ RepairStatus RSi16v<W>::_repair(GFT *const block, const size_t *const error_pos_
 }
 
 
-template<size_t W>
-void RSi16v<W>::_repair_ntt(GFT *const block, const size_t *const error_pos_rbo, size_t error_count, GFT *const temp_ntt1_ecc6) const {
-        ntt.ntt(&block[0]);
-        auto locator_poly = &temp_ntt1_ecc6[block_len];
-        _error_locator_rev(error_pos_rbo, error_count, locator_poly);
+/**
+ * Errors and erasures: erasure_pos_rbo are known error locations, errors at
+ * unknown locations are found from the Forney syndromes
+ * (erasure locator * synds mod x^ecc_len).
+ * Corrects up to 2 * errors + erasures <= ecc_len.
+ */
+template<size_t W, typename V>
+RepairStatus RSi16v<W, V>::_repair_errata(GFT *const block, const size_t *const erasure_pos_rbo, size_t erasure_count, GFT *const temp_ecc8) const {
+    if (erasure_count == 0)
+        return _repair(&block[0], &temp_ecc8[0]);
 
-        auto err_ntt = &temp_ntt1_ecc6[0];
+    // no room left for unknown errors
+    if (erasure_count >= ecc_len)
+        return _repair(&block[0], &erasure_pos_rbo[0], erasure_count, &temp_ecc8[0]);
 
-        // copy synds
-        std::copy_n(&block[0], ecc_len, &err_ntt[0]);
+    r_print("repair errata >");
+    // temp_ecc8 = ecc_len * 8
 
-        for (size_t j = ecc_len; j < ntt_len; ++j) {
-            GFT sum = GFT{0};
-            for (size_t i = 0; i < error_count; ++i)
-                sum = gf.sub(sum, gf.mul(locator_poly[i], err_ntt[j - error_count + i]));
+    // compute synds
+    auto synds = &temp_ecc8[ecc_len * 0];
+    ntt.pntt(&block[0], &synds[0], &temp_ecc8[ecc_len * 1]);
+    r_print_vec("synds", synds, ecc_len);
 
-            err_ntt[j] = sum;
-            block[j] = gf.sub(block[j], sum);
+    // stop if all synds are zero
+    if (std::all_of(&synds[0], &synds[ecc_len], &vec::is_zero<GFT>)) {
+        r_print("no errors detected");
+        return RepairStatus::NoErrors;
+    }
+
+    auto erasure_poly = &temp_ecc8[ecc_len * 6];
+    _error_locator(&erasure_pos_rbo[0], erasure_count, &erasure_poly[0]);
+    r_print_vec("erasure_poly", erasure_poly, ecc_len);
+
+    // Forney syndromes
+    auto evaluator_poly = &synds[0];  // size = ecc_len * 2
+    _error_evaluator(&erasure_poly[0], erasure_count, &evaluator_poly[0], &temp_ecc8[ecc_len * 2]);
+    r_print_vec("forney_synds", evaluator_poly, ecc_len);
+
+    GFT lanes = GFT{0};
+    for (size_t i = 0; i < erasure_count; ++i)
+        lanes |= evaluator_poly[i];
+
+    // the coefficients past the erasures only depend on the unknown errors
+    GFT unknown = GFT{0};
+    for (size_t i = erasure_count; i < ecc_len; ++i)
+        unknown |= evaluator_poly[i];
+
+    unknown = vec::cond<GFT>(unknown != 0);
+    lanes = vec::cond<GFT>((lanes != 0) | (unknown != 0));
+    GFT erasures_only = lanes & ~unknown;
+
+    auto locator_poly = &temp_ecc8[ecc_len * 1];
+    GFT locator_poly_len = GFT{} + 1;
+    if (vec::is_zero(unknown)) {
+        std::fill_n(&locator_poly[0], ecc_len, GFT{0});
+        locator_poly[0] = GFT{} + 1;
+    } else {
+        // Sugiyama overwrites the Forney syndromes of the lanes with erasures only
+        auto forney_synds = &temp_ecc8[ecc_len * 7];
+        if (!vec::is_zero(erasures_only))
+            std::copy_n(&evaluator_poly[0], ecc_len, &forney_synds[0]);
+
+        locator_poly_len = _sugiyama(&locator_poly[0], &evaluator_poly[0], &temp_ecc8[ecc_len * 2], erasure_count);
+
+        if (!vec::is_zero(erasures_only)) {
+            vec::copy_n_masked(&forney_synds[0], ecc_len, &evaluator_poly[0], erasures_only);
+            vec::assign_masked(locator_poly[0], GFT{} + 1, erasures_only);
+            for (size_t i = 1; i < ecc_len; ++i)
+                vec::assign_masked(locator_poly[i], GFT{0}, erasures_only);
+            vec::assign_masked(locator_poly_len, GFT{} + 1, erasures_only);
         }
+    }
+    r_print_vec("error_locator", locator_poly, ecc_len);
+
+    // errata locator = error locator * (1 + x * erasure_poly)
+    std::copy_backward(&erasure_poly[0], &erasure_poly[erasure_count], &erasure_poly[erasure_count + 1]);
+    erasure_poly[0] = GFT{} + 1;
+    ntt.nttr(&erasure_poly[0]);
+    ntt.nttr(&locator_poly[0]);
+    for (size_t i = 0; i < ecc_len; ++i)
+        locator_poly[i] = gf.mul(locator_poly[i], erasure_poly[i]);
+    ntt.inttr(&locator_poly[0]);
+
+    locator_poly_len = (locator_poly_len + ::GFT(erasure_count)) & lanes;
+    r_print_vec("locator_poly", locator_poly, ecc_len);
+    r_print_vec("locator_poly_len", &locator_poly_len, 1);
+
+    auto evaluator_poly_len = vec::poly::len(&evaluator_poly[0], ecc_len);
+
+    auto locator_poly_deriv = &temp_ecc8[ecc_len * 2];
+    std::copy_n(&locator_poly[0], ecc_len, &locator_poly_deriv[0]);
+    _deriv(locator_poly_deriv, ecc_len);
+    auto locator_poly_deriv_len = vec::poly::len(&locator_poly_deriv[0], ecc_len);
+
+    auto roots = &temp_ecc8[ecc_len * 3];
+    auto res = _find_roots_ntt(
+        &block[0],
+        &locator_poly[0], locator_poly_len,
+        &locator_poly_deriv[0], locator_poly_deriv_len,
+        &evaluator_poly[0], evaluator_poly_len,
+        &roots[0]
+    );
+    r_print("repair <");
+    return RepairStatus(vec::max(res));
+}
+
+
+/**
+ * Known error positions, see ErasurePlan
+ */
+template<size_t W, typename V>
+RepairStatus RSi16v<W, V>::_repair(GFT *const block, ErasurePlan const& plan, GFT *const temp_ecc6) const {
+    r_print("repair plan >");
+    // temp_ecc6 = ecc_len * 6
+
+    auto synds = &temp_ecc6[ecc_len * 0];
+    ntt.pntt(&block[0], &synds[0], &temp_ecc6[ecc_len * 1]);
+    r_print_vec("synds", synds, ecc_len);
+
+    if (std::all_of(&synds[0], &synds[ecc_len], &vec::is_zero<GFT>)) {
+        r_print("no errors detected");
+        return RepairStatus::NoErrors;
+    }
+
+    _forney_plan(plan, &synds[0], &block[0]);
+    r_print("repair <");
+    return RepairStatus::RepairOk;
+}
+
+
+/**
+ * Errors and erasures with the erasures of `plan`. Columns with erasures only
+ * are repaired from the plan, otherwise falls back to _repair_errata.
+ */
+template<size_t W, typename V>
+RepairStatus RSi16v<W, V>::_repair_errata(GFT *const block, ErasurePlan const& plan, GFT *const temp_ecc8) const {
+    auto erasure_count = plan.error_count();
+    if (erasure_count == 0)
+        return _repair(&block[0], &temp_ecc8[0]);
+
+    if (erasure_count >= ecc_len)
+        return _repair(&block[0], plan, &temp_ecc8[0]);
+
+    r_print("repair errata plan >");
+    // temp_ecc8 = ecc_len * 8
+
+    auto synds = &temp_ecc8[ecc_len * 0];
+    ntt.pntt(&block[0], &synds[0], &temp_ecc8[ecc_len * 1]);
+    r_print_vec("synds", synds, ecc_len);
+
+    if (std::all_of(&synds[0], &synds[ecc_len], &vec::is_zero<GFT>)) {
+        r_print("no errors detected");
+        return RepairStatus::NoErrors;
+    }
+
+    // Forney syndromes, only used to detect errors outside the erasures
+    auto forney_synds = &temp_ecc8[ecc_len * 2];  // size = ecc_len * 2
+    std::copy_n(&synds[0], ecc_len, &forney_synds[0]);
+    std::fill_n(&forney_synds[ecc_len], ecc_len, GFT{0});
+    ntt.nttr2(&forney_synds[0]);
+    for (size_t i = 0; i < ecc_len * 2; ++i)
+        forney_synds[i] = gf.mul_shoup(forney_synds[i], plan.locator_ntt[i], plan.locator_ntt_q[i]);
+    ntt.inttr2(&forney_synds[0]);
+    r_print_vec("forney_synds", forney_synds, ecc_len);
+
+    GFT unknown = GFT{0};
+    for (size_t i = erasure_count; i < ecc_len; ++i)
+        unknown |= forney_synds[i];
+
+    if (!vec::is_zero(unknown))
+        return _repair_errata(&block[0], &plan.error_pos_rbo[0], erasure_count, &temp_ecc8[0]);
+
+    _forney_plan(plan, &synds[0], &block[0]);
+    r_print("repair <");
+    return RepairStatus::RepairOk;
+}
+
+
+template<size_t W, typename V>
+void RSi16v<W, V>::_repair_ntt(GFT *const block, const size_t *const error_pos_rbo, size_t error_count, GFT *const temp_ntt1_ecc6) const {
+    // extending the spectrum costs (ntt_len - ecc_len) * error_count,
+    // evaluating at the error positions about 4 * block_len * log2(ecc_len).
+    // The extension needs the block to fill the transform.
+    if (block_len != ntt_len || error_count * (ntt_len - ecc_len) > 4 * block_len * ffrs::detail::ilog2_floor(ecc_len)) {
+        _repair_ntt_eval(&block[0], &error_pos_rbo[0], error_count, &temp_ntt1_ecc6[0]);
+        return;
+    }
+
+    ntt.ntt(&block[0]);
+    auto locator_poly = &temp_ntt1_ecc6[block_len];
+    _error_locator_rev(error_pos_rbo, error_count, locator_poly);
+
+    auto err_ntt = &temp_ntt1_ecc6[0];
 
-        std::fill_n(&block[0], ecc_len, GFT{0});
+    // copy synds
+    std::copy_n(&block[0], ecc_len, &err_ntt[0]);
+
+    for (size_t j = ecc_len; j < ntt_len; ++j) {
+        GFT sum = GFT{0};
+        for (size_t i = 0; i < error_count; ++i)
+            sum = gf.sub(sum, gf.mul(locator_poly[i], err_ntt[j - error_count + i]));
+
+        err_ntt[j] = sum;
+        block[j] = gf.sub(block[j], sum);
+    }
+
+    std::fill_n(&block[0], ecc_len, GFT{0});
+
+    // TODO limit to error positions only, test if performance improvement
+    // for (size_t j = 0; j < error_count; ++j) {
+    //     size_t i = error_pos_rbo[j];
+    //     block[i] = gf.div(block[i], ntt_len);
+    // }
+    ntt.intt(&block[0]);
+}
+
+
+/**
+ * Erasure decoding for large error counts: the error evaluator and the
+ * locator derivative are evaluated at the error positions with the pruned
+ * partial iNTT, O(block_len log ecc_len) instead of O(ntt_len * error_count).
+ * temp_ntt1_ecc6 = ntt_len + ecc_len * 6, the sorted error positions are kept past ecc_len * 6
+ */
+template<size_t W, typename V>
+void RSi16v<W, V>::_repair_ntt_eval(GFT *const block, const size_t *const error_pos_rbo, size_t error_count, GFT *const temp_ntt1_ecc6) const {
+    auto temp_ecc6 = &temp_ntt1_ecc6[0];
+
+    auto synds = &temp_ecc6[ecc_len * 0];
+    ntt.pntt(&block[0], &synds[0], &temp_ecc6[ecc_len * 2]);
+
+    auto locator_poly = &temp_ecc6[ecc_len * 4];
+    _error_locator(&error_pos_rbo[0], error_count, &locator_poly[0]);
+
+    auto evaluator_poly = &synds[0];  // size = ecc_len * 2
+    _error_evaluator(&locator_poly[0], error_count, &evaluator_poly[0], &temp_ecc6[ecc_len * 2]);
+
+    auto locator_poly_deriv = &temp_ecc6[ecc_len * 5];
+    std::copy_n(&locator_poly[0], ecc_len, &locator_poly_deriv[0]);
+    _deriv_shifted(locator_poly_deriv, ecc_len);
 
-        // TODO limit to error positions only, test if performance improvement
-        // for (size_t j = 0; j < error_count; ++j) {
-        //     size_t i = error_pos_rbo[j];
-        //     block[i] = gf.div(block[i], ntt_len);
-        // }
-        ntt.intt(&block[0]);
+    // error positions in the order pintt_pruned visits them, error_count <= ecc_len < ntt_len * W
+    auto error_pos = reinterpret_cast<::GFT *>(&temp_ntt1_ecc6[ecc_len * 6]);
+    for (size_t i = 0; i < error_count; ++i)
+        error_pos[i] = ::GFT(ntt.rbo(error_pos_rbo[i]));
+    std::sort(&error_pos[0], &error_pos[error_count]);
+
+    auto eval_at_errors = [&](const GFT *const poly, size_t poly_len, auto&& f) {
+        size_t k = 0;
+        ntt.pintt_pruned(&poly[0], poly_len, block_len, &temp_ecc6[ecc_len * 3],
+            [&](size_t offset, const GFT *const values, size_t count) {
+                for (; k < error_count && error_pos[k] < offset + count; ++k)
+                    f(k, values[error_pos[k] - offset]);
+                return k < error_count;
+            }
+        );
+    };
+
+    // both evaluations miss the same constant factor, Forney only needs their ratio
+    auto numerator = &temp_ecc6[ecc_len * 2];
+    eval_at_errors(evaluator_poly, ecc_len, [&](size_t k, GFT const& value) {
+        numerator[k] = value;
+    });
+    eval_at_errors(locator_poly_deriv, error_count, [&](size_t k, GFT const& value) {
+        auto pos = error_pos[k];
+        GFT x_inv = GFT{} + ntt._roots_i_ntt[ntt.rbo(pos)];
+        block[pos] = gf.add(block[pos], gf.div(numerator[k], gf.mul(value, x_inv)));
+    });
 }
 
 
-template<size_t W>
-inline void RSi16v<W>::sugiyama(::GFT a1[], ::GFT r1[], ::GFT temp_ecc4[]) const {
+template<size_t W, typename V>
+inline void RSi16v<W, V>::sugiyama(::GFT a1[], ::GFT r1[], ::GFT temp_ecc4[]) const {
     _sugiyama(reinterpret_cast<GFT *>(a1), reinterpret_cast<GFT *>(r1), reinterpret_cast<GFT *>(temp_ecc4));
 }
 
 
-template<size_t W>
-RSi16v<W>::GFT RSi16v<W>::_sugiyama(GFT *const a1, GFT *const r1, GFT *const temp_ecc4) const {
-    // r1 = synds
+template<size_t W, typename V>
+RSi16v<W, V>::GFT RSi16v<W, V>::_sugiyama(GFT *const a1, GFT *const r1, GFT *const temp_ecc4, size_t erasure_count) const {
+    // r1 = synds, or Forney syndromes when erasure_count > 0
     // temp_ecc4 = 4 * ecc_len
 
+    // continue while deg(r1) >= (ecc_len + erasure_count) / 2,
+    // erasures raise the degree allowed for the evaluator
+    const auto stop_len = ::GFT((ecc_len + erasure_count + 1) / 2 + 1);
+
     std::fill_n(&temp_ecc4[0], ecc_len * 4, GFT{0});
 
     GFT a1_len;
@@ -335,7 +631,7 @@ RSi16v<W>::GFT RSi16v<W>::_sugiyama(GFT *const a1, GFT *const r1, GFT *const tem
     }
 
     ld_print("------\n");
-    GFT cond = vec::cond<GFT>(r1_len >= ::GFT(ecc_len / 2));
+    GFT cond = vec::cond<GFT>(r1_len >= stop_len);
 
     if (vec::any(cond)) {
         for (size_t i = 1; i < ecc_len / 2; ++i) {
@@ -387,7 +683,7 @@ RSi16v<W>::GFT RSi16v<W>::_sugiyama(GFT *const a1, GFT *const r1, GFT *const tem
             r2l = r1l;
 
             {
-                cond = vec::cond<GFT>(r1_len >= ::GFT(ecc_len / 2));
+                cond = vec::cond<GFT>(r1_len >= stop_len);
 
                 ld_print_vec("update cond", &cond, 1);
 
@@ -440,19 +736,15 @@ RSi16v<W>::GFT RSi16v<W>::_sugiyama(GFT *const a1, GFT *const r1, GFT *const tem
 }
 
 
-template<size_t W>
-RSi16v<W>::GFT RSi16v<W>::_find_roots_ntt(
+template<size_t W, typename V>
+RSi16v<W, V>::GFT RSi16v<W, V>::_find_roots_ntt(
     GFT *const block,
     const GFT *const locator_poly, GFT const& locator_poly_len,
     const GFT *const locator_poly_deriv, GFT const& locator_poly_deriv_len,
     const GFT *const evaluator_poly, GFT const& evaluator_poly_len,
     GFT *const roots
 ) const {
-    std::fill_n(&roots[0], ntt_len, GFT{0});
-    std::copy_n(&locator_poly[0], ecc_len, &roots[0]);
-
     py_assert(vec::max(locator_poly_len) <= ecc_len);
-    ntt.pintt_ecc(&roots[0]);
 
     GFT lanes = vec::cond<GFT>(locator_poly_len != 0);
 
@@ -462,58 +754,124 @@ RSi16v<W>::GFT RSi16v<W>::_find_roots_ntt(
     r_print("locator_poly_deriv_len_max", locator_poly_deriv_len_max);
     r_print("evaluator_poly_len_max", evaluator_poly_len_max);
 
+    // roots = [pintt temp | root positions | inverse roots], ecc_len each
+    auto root_pos = &roots[ecc_len];
+    auto root_x_inv = &roots[ecc_len * 2];
+    std::fill_n(&root_x_inv[0], ecc_len, GFT{0});
+
     GFT root_count = GFT{0};
+    // a locator of degree d has at most d roots
+    GFT degree = (locator_poly_len - 1) & lanes;
+
+    // collect the roots of each lane
+    ntt.pintt_pruned(&locator_poly[0], vec::max(locator_poly_len & lanes), block_len, &roots[0],
+        [&](size_t offset, const GFT *const values, size_t count) {
+            for (size_t k = 0; k < count; ++k) {
+                GFT root_locations = (values[k] == 0) & lanes;
+
+                if (vec::any(root_locations)) {
+                    ::GFT i = ::GFT(offset + k);
+                    ::GFT x_inv = ntt._roots_i_ntt[ntt.rbo(i)];
+
+                    if constexpr (std::is_integral_v<GFT>) {
+                        root_pos[root_count] = i;
+                        root_x_inv[root_count] = x_inv;
+                    } else {
+                        for (size_t j = 0; j < W; ++j) {
+                            if (root_locations[j]) {
+                                root_pos[root_count[j]][j] = i;
+                                root_x_inv[root_count[j]][j] = x_inv;
+                            }
+                        }
+                    }
+
+                    root_count += 1 & root_locations;
+                }
+            }
 
-    for (::GFT i = 0; i < block_len; ++i) {
-        auto i_rbo = ntt.rbo(i);
-        // auto x = gf.pow(root, i_rbo);
-        ::GFT x = ntt._roots_ntt[i_rbo];
-        GFT root_locations = (roots[i] == 0) & lanes;
+            // stop once every lane found all the roots of its locator
+            return vec::any(root_count < degree);
+        }
+    );
 
-        root_count += 1 & root_locations;
+    // A locator of degree d locates d errors. With fewer roots in the block, there are
+    // more errors than the lane can correct (with erasures, their factor of the
+    // locator always supplies roots), the lane is left untouched.
+    r_print_vec("root_count", &root_count, 1);
+    GFT located = vec::cond<GFT>((root_count == degree) & (root_count != 0)) & lanes;
+    r_print_vec("located", &located, 1);
 
-        if (vec::any(root_locations)) {
-            GFT error = _forney(
-                &locator_poly_deriv[0], locator_poly_deriv_len_max,
-                &evaluator_poly[0], evaluator_poly_len_max,
-                x
-            );
+    // evaluate the k-th root of all lanes at once
+    auto root_count_max = vec::max(root_count & located);
+    for (size_t k = 0; k < root_count_max; ++k) {
+        GFT error = _forney(
+            &locator_poly_deriv[0], locator_poly_deriv_len_max,
+            &evaluator_poly[0], evaluator_poly_len_max,
+            root_x_inv[k]
+        );
+        r_print_vec("root_pos", &root_pos[k], 1);
+        r_print_vec("error", &error, 1);
 
-            if constexpr (!std::is_integral_v<GFT>)
-                error &= root_locations;
+        if constexpr (std::is_integral_v<GFT>) {
+            block[root_pos[k]] = gf.add(block[root_pos[k]], error);
+        } else {
+            for (size_t j = 0; j < W; ++j) {
+                if (located[j] && k < root_count[j]) {
+                    auto& b = block[root_pos[k][j]][j];
+                    b = gf.add(b, error[j]);
+                }
+            }
+        }
+    }
+
+    GFT not_located = lanes & ~located;
+    return (::GFT(RepairStatus::RepairOk) & located) | (::GFT(RepairStatus::ErrorLocationFail) & not_located);
+}
 
-            r_print("i:", i, "rbo(i):", i_rbo);
-            r_print_vec("error", &error, 1);
 
-            block[i] = gf.add(block[i], error);
+template<size_t W, typename V>
+void RSi16v<W, V>::_forney_plan(ErasurePlan const& plan, const GFT *const synds, GFT *const block) const {
+    // mul_shoup_residue terms are below 2p, sums of up to 2^14 of them stay below 2^31
+    constexpr size_t chunk = size_t(1) << 14;
+
+    auto error_count = plan.error_count();
+    for (size_t k = 0; k < error_count; ++k) {
+        auto forney = &plan.forney[k * error_count];
+        auto forney_q = &plan.forney_q[k * error_count];
+
+        GFT error = GFT{0};
+        for (size_t j0 = 0; j0 < error_count; j0 += chunk) {
+            GFT sum = GFT{0};
+            for (size_t j = j0; j < std::min(j0 + chunk, error_count); ++j)
+                sum += gf.mul_shoup_residue(synds[j], forney[j], forney_q[j]);
+            error = gf.add(error, gf.mod_p(sum));
         }
-    }
-    r_print_vec("root_count", &root_count, 1);
+        r_print("error pos:", plan.error_pos[k]);
+        r_print_vec("error", &error, 1);
 
-    GFT no_root_found = vec::cond<GFT>((root_count == 0) & lanes);
-    r_print_vec("no_root_found", &no_root_found, 1);
-    GFT roots_found = vec::cond<GFT>(root_count > 0);
-    return (::GFT(RepairStatus::RepairOk) & roots_found) | (::GFT(RepairStatus::ErrorLocationFail) & no_root_found);
+        auto pos = plan.error_pos[k];
+        block[pos] = gf.add(block[pos], error);
+    }
 }
 
 
-template<size_t W>
-RSi16v<W>::GFT RSi16v<W>::_forney(
+template<size_t W, typename V>
+RSi16v<W, V>::GFT RSi16v<W, V>::_forney(
     const GFT *const locator_poly_deriv, size_t locator_poly_deriv_len,
     const GFT *const evaluator_poly, size_t evaluator_poly_len,
-    ::GFT const& x
+    GFT const& x_inv
 ) const {
-    auto x_inv = GFT{} + gf.inv(x);
     auto numerator = _eval(evaluator_poly, evaluator_poly_len, x_inv);
     auto denominator = _eval(locator_poly_deriv, locator_poly_deriv_len, x_inv);
 
-    auto error = gf.mul(gf.div(numerator, denominator), x);
+    // numerator / denominator * x
+    auto error = gf.div(numerator, gf.mul(denominator, x_inv));
     return error;
 }
 
 
-template<size_t W>
-inline void RSi16v<W>::_error_locator_rev(const size_t *const error_pos_rbo, size_t error_count, GFT *const locator_poly) const {
+template<size_t W, typename V>
+inline void RSi16v<W, V>::_error_locator_rev(const size_t *const error_pos_rbo, size_t error_count, GFT *const locator_poly) const {
     std::fill_n(&locator_poly[0], ecc_len, GFT{0});
 
     size_t last_error = error_count - 1;
@@ -528,8 +886,8 @@ inline void RSi16v<W>::_error_locator_rev(const size_t *const error_pos_rbo, siz
 }
 
 
-template<size_t W>
-inline void RSi16v<W>::_error_locator(const size_t *const error_pos_rbo, size_t error_count, GFT *const locator_poly) const {
+template<size_t W, typename V>
+inline void RSi16v<W, V>::_error_locator(const size_t *const error_pos_rbo, size_t error_count, GFT *const locator_poly) const {
     std::fill_n(&locator_poly[0], ecc_len, GFT{0});
 
     for (size_t j = 0; j < error_count; ++j) {
@@ -542,8 +900,8 @@ inline void RSi16v<W>::_error_locator(const size_t *const error_pos_rbo, size_t
 }
 
 
-template<size_t W>
-inline void RSi16v<W>::_error_evaluator(const GFT *const locator_poly, size_t locator_poly_deg, GFT *const evaluator_poly, GFT *const temp) const {
+template<size_t W, typename V>
+inline void RSi16v<W, V>::_error_evaluator(const GFT *const locator_poly, size_t locator_poly_deg, GFT *const evaluator_poly, GFT *const temp) const {
     // evaluator_poly initialized with synds
     std::fill_n(&evaluator_poly[ecc_len], ecc_len, GFT{0});
 
@@ -551,7 +909,7 @@ inline void RSi16v<W>::_error_evaluator(const GFT *const locator_poly, size_t lo
 
     std::copy_n(&locator_poly[0], locator_poly_deg, &temp[1]);
     temp[0] = GFT{} + 1;
-    std::fill_n(&temp[locator_poly_deg + 1], ecc_len * 2 - locator_poly_deg, GFT{0});
+    std::fill_n(&temp[locator_poly_deg + 1], ecc_len * 2 - locator_poly_deg - 1, GFT{0});
 
     ntt.nttr2(&temp[0]);
 
@@ -563,20 +921,22 @@ inline void RSi16v<W>::_error_evaluator(const GFT *const locator_poly, size_t lo
 }
 
 
-template<size_t W>
-inline size_t RSi16v<W>::_vec_shift(const GFT *const a, size_t a_len, size_t shift, GFT *const r) const {
+template<size_t W, typename V>
+inline size_t RSi16v<W, V>::_vec_shift(const GFT *const a, size_t a_len, size_t shift, GFT *const r) const {
     // ::GFT ecc_root = gf.pow(root, ntt_len / ecc_len);
 
-    for (size_t i = 0; i < ecc_len; ++i)
+    for (size_t i = 0; i < ecc_len; ++i) {
         // r[i] = gf.mul(a[i], gf.pow(ecc_root, shift * ntt._rbo_ecc[i] & ecc_len_mask));
-        r[i] = gf.mul(a[i], ntt._roots_ecc[shift * ntt._rbo_ecc[i] & ecc_len_mask]);
+        auto k = shift * ntt._rbo_ecc[i] & ecc_len_mask;
+        r[i] = gf.mul_shoup(a[i], ntt._roots_ecc[k], ntt._roots_ecc_q[k]);
+    }
 
     return a_len + shift;
 }
 
 
-template<size_t W>
-inline RSi16v<W>::GFT RSi16v<W>::_vec_sub(const GFT *const a, GFT a_len, GFT *const b, GFT b_len, GFT *const r) const {
+template<size_t W, typename V>
+inline RSi16v<W, V>::GFT RSi16v<W, V>::_vec_sub(const GFT *const a, GFT a_len, GFT *const b, GFT b_len, GFT *const r) const {
     for (size_t i = 0; i < ecc_len; ++i)
         r[i] = gf.sub(a[i], b[i]);
 
@@ -584,8 +944,8 @@ inline RSi16v<W>::GFT RSi16v<W>::_vec_sub(const GFT *const a, GFT a_len, GFT *co
 }
 
 
-template<size_t W>
-inline size_t RSi16v<W>::_norm_size_rev(GFT *const r, size_t r_len) const {
+template<size_t W, typename V>
+inline size_t RSi16v<W, V>::_norm_size_rev(GFT *const r, size_t r_len) const {
     check_le_ecc(r_len);
     size_t start = r_len;
     while (start < ecc_len && vec::is_zero(r[start]))
@@ -605,8 +965,8 @@ inline size_t RSi16v<W>::_norm_size_rev(GFT *const r, size_t r_len) const {
 }
 
 
-template<size_t W>
-inline size_t RSi16v<W>::_deriv(GFT *const r, size_t r_len) const {
+template<size_t W, typename V>
+inline size_t RSi16v<W, V>::_deriv(GFT *const r, size_t r_len) const {
     check_le_ecc(r_len);
 
     for (::GFT i = 0; i < r_len - 1; ++i)
@@ -616,8 +976,8 @@ inline size_t RSi16v<W>::_deriv(GFT *const r, size_t r_len) const {
 }
 
 
-template<size_t W>
-inline size_t RSi16v<W>::_deriv_shifted(GFT *const r, size_t r_len) const {
+template<size_t W, typename V>
+inline size_t RSi16v<W, V>::_deriv_shifted(GFT *const r, size_t r_len) const {
     check_le_ecc(r_len);
 
     for (::GFT i = 0; i < r_len; ++i)
@@ -625,8 +985,8 @@ inline size_t RSi16v<W>::_deriv_shifted(GFT *const r, size_t r_len) const {
     return r_len;
 }
 
-template<size_t W>template<typename T>
-inline T RSi16v<W>::_eval(const T *const r, size_t r_len, T x) const {
+template<size_t W, typename V>template<typename T>
+inline T RSi16v<W, V>::_eval(const T *const r, size_t r_len, T x) const {
     check_le_ecc(r_len);
 
     T sum = T{0};
@@ -636,8 +996,8 @@ inline T RSi16v<W>::_eval(const T *const r, size_t r_len, T x) const {
 }
 
 
-template<size_t W>
-inline void RSi16v<W>::_reverse_ntt(GFT *const vec, size_t shift) const {
+template<size_t W, typename V>
+inline void RSi16v<W, V>::_reverse_ntt(GFT *const vec, size_t shift) const {
     check_le_ecc(shift);
 
     for (size_t i = 1; i < ecc_len; ++i) {
@@ -646,21 +1006,21 @@ inline void RSi16v<W>::_reverse_ntt(GFT *const vec, size_t shift) const {
         auto k = ntt._rbo_ecc[ecc_len - j];
         if (i < k)
             std::swap(vec[i], vec[k]);
-        vec[i] = gf.mul(vec[i], ntt._roots_i_ecc[j]);
-        vec[i] = gf.mul(vec[i], ntt._roots_ecc[shift * j & ecc_len_mask]);
+        vec[i] = gf.mul_shoup(vec[i], ntt._roots_i_ecc[j], ntt._roots_i_ecc_q[j]);
+        vec[i] = gf.mul_shoup(vec[i], ntt._roots_ecc[shift * j & ecc_len_mask], ntt._roots_ecc_q[shift * j & ecc_len_mask]);
     }
 }
 
 
-template<size_t W>
-inline void RSi16v<W>::_reverse_ntt_vec(GFT *const vec, GFT shift) const {
+template<size_t W, typename V>
+inline void RSi16v<W, V>::_reverse_ntt_vec(GFT *const vec, GFT shift) const {
     for (size_t i = 1; i < ecc_len; ++i) {
         // ntt.rbo(ecc_len - ntt.rbo(i))
         auto j = ntt._rbo_ecc[i];
         auto k = ntt._rbo_ecc[ecc_len - j];
         if (i < k)
             std::swap(vec[i], vec[k]);
-        vec[i] = gf.mul(vec[i], ntt._roots_i_ecc[j]);
+        vec[i] = gf.mul_shoup(vec[i], ntt._roots_i_ecc[j], ntt._roots_i_ecc_q[j]);
         vec[i] = gf.mul(vec[i], gf.gather(&ntt._roots_ecc[0], shift * j & ::GFT(ecc_len_mask)));
     }
 }
@@ -798,7 +1158,13 @@ py::bytearray NTT::py_poly_inv(buffer_ro<uint16_t> input, size_t n) const {
 
 #define RSI16V_IMPL_GFT simd_map_t<RSI16V_IMPL_INSTANCE_W>
 
-template class RSi16v<RSI16V_IMPL_INSTANCE_W>;
+// also used by translation units building a second variant, see rsi16v_avx2.cpp
+#define RSI16V_IMPL_INSTANTIATE(W, V) \
+    template class RSi16v<W, V>; \
+    template void RSi16v<W, V>::_encode(const uint16_t src[], size_t, size_t, size_t, V ecc[], V temp_ecc[]) const; \
+    template void RSi16v<W, V>::_encode(const ::GFT src[], size_t, size_t, size_t, V ecc[], V temp_ecc[]) const;
+
+RSI16V_IMPL_INSTANTIATE(RSI16V_IMPL_INSTANCE_W, RSI16V_IMPL_GFT)
 template py::bytearray NTT::py_ntt<RSI16V_IMPL_GFT>(buffer_ro<uint16_t> input) const;
 template py::bytearray NTT::py_intt<RSI16V_IMPL_GFT>(buffer_ro<uint16_t> input) const;
 template py::bytearray NTT::py_nttr<RSI16V_IMPL_GFT>(buffer_ro<uint16_t> input) const;
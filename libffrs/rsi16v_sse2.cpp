@@ -43,26 +43,240 @@ GFTx4 ffrs::simd_gather_base::gather(const uint32_t vec[], GFTx4 const& i) {
 }
 
 
+template<>
+simd_mask_t vec::is_zero<GFTx4>(GFTx4 const& vec) {
+    // return !(vec[0] || vec[1] || vec[2] || vec[3]);
+    return _mm_movemask_epi8(_mm_cmpeq_epi32((__m128i) vec, _mm_setzero_si128())) == 0xffff;
+}
+
+
+static inline __m128i cmplt_epu32(__m128i a, __m128i b) {
+    auto sign = _mm_set1_epi32(int32_t(0x80000000));
+    return _mm_cmplt_epi32(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign));
+}
+
+
+static inline __m128i select(__m128i mask, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+
+static inline __m128i nonzero_mask(GFTx4 const& condition) {
+    return _mm_xor_si128(
+        _mm_cmpeq_epi32((__m128i) condition, _mm_setzero_si128()),
+        _mm_set1_epi32(-1)
+    );
+}
+
+
 template<>
 void vec::assign_masked<GFTx4>(GFTx4& vec, GFTx4 const& value, GFTx4 const& condition) {
-    for (int j = 0; j < 4; j++)
-        if (condition[j])
-            vec[j] = value[j];
+    vec = (GFTx4) select(nonzero_mask(condition), (__m128i) value, (__m128i) vec);
 }
 
 
 template<>
 void vec::copy_n_masked<GFTx4>(const GFTx4 src[], size_t n, GFTx4 dst[], GFTx4 const& condition) {
-    for (size_t i = 0; i < n; i++) {
-        for (int j = 0; j < 4; j++)
-            if (condition[j])
-                dst[i][j] = src[i][j];
+    auto mask = nonzero_mask(condition);
+    for (size_t i = 0; i < n; i++)
+        dst[i] = (GFTx4) select(mask, (__m128i) src[i], (__m128i) dst[i]);
+}
+
+
+template<>
+GFTx4 vec::min<GFTx4>(GFTx4 const& a, GFTx4 const& b) {
+    return (GFTx4) select(cmplt_epu32((__m128i) a, (__m128i) b), (__m128i) a, (__m128i) b);
+}
+
+
+template<>
+GFTx4 vec::max<GFTx4>(GFTx4 const& a, GFTx4 const& b) {
+    return (GFTx4) select(cmplt_epu32((__m128i) a, (__m128i) b), (__m128i) b, (__m128i) a);
+}
+
+
+template<>
+GFT vec::min<GFTx4>(GFTx4 const& a) {
+    auto m = vec::min(a, (GFTx4) _mm_shuffle_epi32((__m128i) a, _MM_SHUFFLE(1, 0, 3, 2)));
+    m = vec::min(m, (GFTx4) _mm_shuffle_epi32((__m128i) m, _MM_SHUFFLE(2, 3, 0, 1)));
+    return GFT(_mm_cvtsi128_si32((__m128i) m));
+}
+
+
+template<>
+GFT vec::max<GFTx4>(GFTx4 const& a) {
+    auto m = vec::max(a, (GFTx4) _mm_shuffle_epi32((__m128i) a, _MM_SHUFFLE(1, 0, 3, 2)));
+    m = vec::max(m, (GFTx4) _mm_shuffle_epi32((__m128i) m, _MM_SHUFFLE(2, 3, 0, 1)));
+    return GFT(_mm_cvtsi128_si32((__m128i) m));
+}
+
+
+template<>
+GFTx4 vec::gather<GFTx4>(const GFTx4 src[], GFTx4 const& i) {
+    return GFTx4{
+        src[i[0]][0],
+        src[i[1]][1],
+        src[i[2]][2],
+        src[i[3]][3]
+    };
+}
+
+
+/**
+ * Iterate over destination rows so that every store is a full row: lane j
+ * of row r is written when r - dst_offset[j] < n[j]
+ */
+template<>
+void vec::copy_n<GFTx4>(const GFTx4 src[], GFTx4 const& src_offset, GFTx4 n, GFTx4 dst[], GFTx4 const& dst_offset) {
+    auto active = (GFTx4) (n != 0);
+    if (vec::is_zero(active))
+        return;
+
+    size_t begin = vec::min(dst_offset | ~active);
+    size_t end = vec::max((dst_offset + n) & active);
+
+    for (size_t r = begin; r < end; ++r) {
+        auto i = GFT(r) - dst_offset;
+        auto mask = cmplt_epu32((__m128i) i, (__m128i) n);
+        if (_mm_movemask_epi8(mask) == 0)
+            continue;
+
+        auto row = (GFTx4) mask & (i + src_offset);
+        auto v = vec::gather(src, row);
+        dst[r] = (GFTx4) select(mask, (__m128i) v, (__m128i) dst[r]);
     }
 }
 
 
 template<>
-simd_mask_t vec::is_zero<GFTx4>(GFTx4 const& vec) {
-    // return !(vec[0] || vec[1] || vec[2] || vec[3]);
-    return _mm_movemask_epi8(_mm_cmpeq_epi32((__m128i) vec, _mm_setzero_si128())) == 0xffff;
+void vec::fill_n<GFTx4>(GFTx4 dst[], GFTx4 const& dst_offset, GFTx4 n, GFTx4 const& value) {
+    auto active = (GFTx4) (n != 0);
+    if (vec::is_zero(active))
+        return;
+
+    size_t begin = vec::min(dst_offset | ~active);
+    size_t end = vec::max((dst_offset + n) & active);
+
+    for (size_t r = begin; r < end; ++r) {
+        auto mask = cmplt_epu32((__m128i) (GFT(r) - dst_offset), (__m128i) n);
+        dst[r] = (GFTx4) select(mask, (__m128i) value, (__m128i) dst[r]);
+    }
+}
+
+
+/**
+ * 4x4 transpose of 32-bit elements
+ */
+static inline void transpose4(__m128i rows[4]) {
+    auto t0 = _mm_unpacklo_epi32(rows[0], rows[1]);
+    auto t1 = _mm_unpackhi_epi32(rows[0], rows[1]);
+    auto t2 = _mm_unpacklo_epi32(rows[2], rows[3]);
+    auto t3 = _mm_unpackhi_epi32(rows[2], rows[3]);
+    rows[0] = _mm_unpacklo_epi64(t0, t2);
+    rows[1] = _mm_unpackhi_epi64(t0, t2);
+    rows[2] = _mm_unpacklo_epi64(t1, t3);
+    rows[3] = _mm_unpackhi_epi64(t1, t3);
+}
+
+
+static inline __m128i load_widen(const uint16_t src[]) {
+    return _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *) src), _mm_setzero_si128());
+}
+
+
+static inline void store_narrow(uint16_t dst[], __m128i v) {
+    // sign-extend the low 16 bits so that the signed pack keeps them unchanged
+    v = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+    _mm_storel_epi64((__m128i *) dst, _mm_packs_epi32(v, v));
+}
+
+
+template<>
+void vec::load_transposed<4, uint16_t>(const uint16_t src[], size_t src_stride, GFT dst[], size_t rows, size_t cols) {
+    size_t r = 0;
+    if (cols == 4) {
+        for (; r + 4 <= rows; r += 4) {
+            __m128i v[4];
+            for (size_t j = 0; j < 4; ++j)
+                v[j] = load_widen(&src[j * src_stride + r]);
+            transpose4(v);
+            for (size_t i = 0; i < 4; ++i)
+                _mm_storeu_si128((__m128i *) &dst[(r + i) * 4], v[i]);
+        }
+    }
+
+    for (size_t j = 0; j < cols; ++j)
+        for (size_t i = r; i < rows; ++i)
+            dst[i * 4 + j] = src[j * src_stride + i];
+}
+
+
+template<>
+void vec::load_stride<4, uint16_t>(const uint16_t src[], size_t src_stride, GFT dst[], size_t rows, size_t cols) {
+    if (cols == 4) {
+        for (size_t r = 0; r < rows; ++r)
+            _mm_storeu_si128((__m128i *) &dst[r * 4], load_widen(&src[r * src_stride]));
+        return;
+    }
+
+    for (size_t r = 0; r < rows; ++r)
+        for (size_t j = 0; j < cols; ++j)
+            dst[r * 4 + j] = src[r * src_stride + j];
+}
+
+
+template<>
+void vec::store_transposed<4, uint16_t>(const GFT src[], uint16_t dst[], size_t dst_stride, size_t rows, size_t cols) {
+    size_t r = 0;
+    if (cols == 4) {
+        for (; r + 4 <= rows; r += 4) {
+            __m128i v[4];
+            for (size_t i = 0; i < 4; ++i)
+                v[i] = _mm_loadu_si128((const __m128i *) &src[(r + i) * 4]);
+            transpose4(v);
+            for (size_t j = 0; j < 4; ++j)
+                store_narrow(&dst[j * dst_stride + r], v[j]);
+        }
+    }
+
+    for (size_t j = 0; j < cols; ++j)
+        for (size_t i = r; i < rows; ++i)
+            dst[j * dst_stride + i] = uint16_t(src[i * 4 + j]);
 }
+
+
+template<>
+void vec::store_transposed<4, GFT>(const GFT src[], GFT dst[], size_t dst_stride, size_t rows, size_t cols) {
+    size_t r = 0;
+    if (cols == 4) {
+        for (; r + 4 <= rows; r += 4) {
+            __m128i v[4];
+            for (size_t i = 0; i < 4; ++i)
+                v[i] = _mm_loadu_si128((const __m128i *) &src[(r + i) * 4]);
+            transpose4(v);
+            for (size_t j = 0; j < 4; ++j)
+                _mm_storeu_si128((__m128i *) &dst[j * dst_stride + r], v[j]);
+        }
+    }
+
+    for (size_t j = 0; j < cols; ++j)
+        for (size_t i = r; i < rows; ++i)
+            dst[j * dst_stride + i] = src[i * 4 + j];
+}
+
+
+template<>
+void vec::store_stride<4, uint16_t>(const GFT src[], uint16_t dst[], size_t dst_stride, size_t rows, size_t cols) {
+    if (cols == 4) {
+        for (size_t r = 0; r < rows; ++r)
+            store_narrow(&dst[r * dst_stride], _mm_loadu_si128((const __m128i *) &src[r * 4]));
+        return;
+    }
+
+    for (size_t r = 0; r < rows; ++r)
+        for (size_t j = 0; j < cols; ++j)
+            dst[r * dst_stride + j] = uint16_t(src[r * 4 + j]);
+}
+
+
+const vec::layout_kernels vec::layout_sse2 = vec::layout_kernels::of<4>();
@@ -20,7 +20,9 @@
 
 #include <algorithm>
 #include <array>
+#include <cstddef>
 #include <stdexcept>
+#include <type_traits>
 #include <vector>
 
 #include "pygfi16.hpp"
@@ -36,6 +38,76 @@ typedef GFT GFTx8 __attribute__((vector_size(8 * sizeof(GFT))));
 typedef GFT GFTx16 __attribute__((vector_size(16 * sizeof(GFT))));
 
 
+namespace vec {
+
+/**
+ * Two vectors used as one with twice the lanes, `lo` holding the first half. Lets a wide
+ * kernel be built for a narrower instruction set as two interleaved instruction streams.
+ * Being a distinct type from the native vector of the same width, its template instances
+ * never merge at link time with the ones built for the wider instruction set.
+ *
+ * Scalars broadcast to every lane, comparisons return all-ones lanes of the same type.
+ */
+template<typename V>
+struct x2 {
+    using lane_type = std::remove_cvref_t<decltype(V{}[0])>;
+    static constexpr size_t half = sizeof(V) / sizeof(lane_type);
+
+    V lo, hi;
+
+    x2() = default;
+    constexpr x2(V lo, V hi): lo(lo), hi(hi) { }
+
+    template<typename S> requires std::is_arithmetic_v<S>
+    constexpr x2(S s): lo(V{} + lane_type(s)), hi(V{} + lane_type(s)) { }
+
+    inline lane_type& operator[](size_t i) { return reinterpret_cast<lane_type *>(this)[i]; }
+    inline lane_type operator[](size_t i) const { return i < half ? lo[i] : hi[i - half]; }
+
+#define FFRS_X2_ARITHMETIC(op) \
+    friend inline x2 operator op(x2 const& a, x2 const& b) { return {a.lo op b.lo, a.hi op b.hi}; } \
+    inline x2& operator op##=(x2 const& b) { lo op##= b.lo; hi op##= b.hi; return *this; }
+
+#define FFRS_X2_COMPARISON(op) \
+    friend inline x2 operator op(x2 const& a, x2 const& b) { return {(V) (a.lo op b.lo), (V) (a.hi op b.hi)}; }
+
+    FFRS_X2_ARITHMETIC(+)
+    FFRS_X2_ARITHMETIC(-)
+    FFRS_X2_ARITHMETIC(*)
+    FFRS_X2_ARITHMETIC(&)
+    FFRS_X2_ARITHMETIC(|)
+    FFRS_X2_ARITHMETIC(^)
+    FFRS_X2_ARITHMETIC(<<)
+    FFRS_X2_ARITHMETIC(>>)
+    FFRS_X2_COMPARISON(==)
+    FFRS_X2_COMPARISON(!=)
+    FFRS_X2_COMPARISON(<)
+    FFRS_X2_COMPARISON(<=)
+    FFRS_X2_COMPARISON(>)
+    FFRS_X2_COMPARISON(>=)
+    FFRS_X2_COMPARISON(&&)
+    FFRS_X2_COMPARISON(||)
+
+#undef FFRS_X2_ARITHMETIC
+#undef FFRS_X2_COMPARISON
+
+    friend inline x2 operator~(x2 const& a) { return {~a.lo, ~a.hi}; }
+    friend inline x2 operator-(x2 const& a) { return {-a.lo, -a.hi}; }
+    friend inline x2 operator!(x2 const& a) { return {(V) !a.lo, (V) !a.hi}; }
+};
+
+template<typename T>
+inline constexpr bool is_x2_v = false;
+
+template<typename V>
+inline constexpr bool is_x2_v<x2<V>> = true;
+
+}
+
+// 16 lanes as two AVX2 vectors
+typedef vec::x2<GFTx8> GFTx8x2;
+
+
 template<int N>
 using simd_map_t =
     std::conditional_t<N == 1, GFT,
@@ -71,12 +143,10 @@ template<typename GFT>
 inline bool any(GFT const& a) {
     if constexpr (std::is_integral_v<GFT>) {
         return a != 0;
+    } else if constexpr (is_x2_v<GFT>) {
+        return !vec::is_zero(a);
     } else {
-        for (size_t i = 0; i < sizeof(GFT) / sizeof(::GFT); ++i) {
-            if (a[i] != 0)
-                return true;
-        }
-        return false;
+        return !vec::is_zero((simd_map_t<sizeof(GFT) / sizeof(::GFT)>) a);
     }
 }
 
@@ -183,6 +253,26 @@ void fill_n(GFT *const dst, GFT const& dst_offset, GFT n, GFT const& value) {
     }
 }
 
+/**
+ * Width-specific implementations, defined along with the ISA translation units
+ */
+#define FFRS_VEC_DECLARE_SPECIALIZATIONS(T) \
+    template<> ::GFT min<T>(T const& a); \
+    template<> T min<T>(T const& a, T const& b); \
+    template<> ::GFT max<T>(T const& a); \
+    template<> T max<T>(T const& a, T const& b); \
+    template<> T gather<T>(const T *const src, T const& i); \
+    template<> void copy_n<T>(const T *const src, T const& src_offset, T n, T *const dst, T const& dst_offset); \
+    template<> void fill_n<T>(T *const dst, T const& dst_offset, T n, T const& value);
+
+FFRS_VEC_DECLARE_SPECIALIZATIONS(GFTx4)
+FFRS_VEC_DECLARE_SPECIALIZATIONS(GFTx8)
+FFRS_VEC_DECLARE_SPECIALIZATIONS(GFTx16)
+FFRS_VEC_DECLARE_SPECIALIZATIONS(GFTx8x2)
+
+#undef FFRS_VEC_DECLARE_SPECIALIZATIONS
+
+
 template<typename Src, typename Dst>
 inline void copy_transposed(const Src src[], size_t src_cols, Dst dst[], size_t dst_cols) {
     for (size_t j = 0; j < src_cols; ++j)
@@ -223,6 +313,157 @@ inline void copy_stride(const Src *src, size_t src_stride, Dst *dst, size_t dst_
     // }
 }
 
+
+/**
+ * Conversions between row-major storage and `W`-lane vectors held in a ::GFT array with row
+ * stride W, for r < rows and lane j < cols:
+ *
+ *   load_transposed:  dst[r * W + j] = src[j * src_stride + r]
+ *   load_stride:      dst[r * W + j] = src[r * src_stride + j]
+ *   store_transposed: dst[j * dst_stride + r] = src[r * W + j]
+ *   store_stride:     dst[r * dst_stride + j] = src[r * W + j]
+ *   load_cols:        dst[r * W + j] = src[r * src_stride + col[j]]
+ *   store_cols:       dst[r * dst_stride + col[j]] = src[r * W + j]
+ *
+ * Lanes [cols, W) of a load destination are left untouched. Stores to uint16_t keep the low
+ * 16 bits. The ISA translation units specialize the uint16_t conversions of their width with
+ * widening/narrowing block transposes, used when cols == W.
+ */
+template<size_t W, typename Src>
+inline void load_transposed(const Src src[], size_t src_stride, ::GFT dst[], size_t rows, size_t cols) {
+    copy_transposed(&src[0], src_stride, rows, &dst[0], W, cols);
+}
+
+template<size_t W, typename Src>
+inline void load_stride(const Src src[], size_t src_stride, ::GFT dst[], size_t rows, size_t cols) {
+    copy_stride(&src[0], src_stride, &dst[0], W, cols, rows);
+}
+
+template<size_t W, typename Dst>
+inline void store_transposed(const ::GFT src[], Dst dst[], size_t dst_stride, size_t rows, size_t cols) {
+    copy_transposed(&src[0], W, cols, &dst[0], dst_stride, rows);
+}
+
+template<size_t W, typename Dst>
+inline void store_stride(const ::GFT src[], Dst dst[], size_t dst_stride, size_t rows, size_t cols) {
+    copy_stride(&src[0], W, &dst[0], dst_stride, cols, rows);
+}
+
+template<size_t W, typename Src>
+inline void load_cols(const Src src[], size_t src_stride, const size_t col[], ::GFT dst[], size_t rows, size_t cols) {
+    for (size_t r = 0; r < rows; ++r)
+        for (size_t j = 0; j < cols; ++j)
+            dst[r * W + j] = src[r * src_stride + col[j]];
+}
+
+template<size_t W, typename Dst>
+inline void store_cols(const ::GFT src[], Dst dst[], size_t dst_stride, const size_t col[], size_t rows, size_t cols) {
+    for (size_t r = 0; r < rows; ++r)
+        for (size_t j = 0; j < cols; ++j)
+            dst[r * dst_stride + col[j]] = Dst(src[r * W + j]);
+}
+
+#define FFRS_VEC_DECLARE_CONVERSIONS(W) \
+    template<> void load_transposed<W, uint16_t>(const uint16_t src[], size_t src_stride, ::GFT dst[], size_t rows, size_t cols); \
+    template<> void load_stride<W, uint16_t>(const uint16_t src[], size_t src_stride, ::GFT dst[], size_t rows, size_t cols); \
+    template<> void store_transposed<W, uint16_t>(const ::GFT src[], uint16_t dst[], size_t dst_stride, size_t rows, size_t cols); \
+    template<> void store_transposed<W, ::GFT>(const ::GFT src[], ::GFT dst[], size_t dst_stride, size_t rows, size_t cols); \
+    template<> void store_stride<W, uint16_t>(const ::GFT src[], uint16_t dst[], size_t dst_stride, size_t rows, size_t cols);
+
+FFRS_VEC_DECLARE_CONVERSIONS(4)
+FFRS_VEC_DECLARE_CONVERSIONS(8)
+FFRS_VEC_DECLARE_CONVERSIONS(16)
+
+#undef FFRS_VEC_DECLARE_CONVERSIONS
+
+
+/**
+ * uint16_t conversions of one instruction set, looked up at run time because a width can be
+ * built for more than one. Each ISA translation unit defines the table of its variant.
+ */
+struct layout_kernels {
+    void (*load_transposed)(const uint16_t src[], size_t src_stride, ::GFT dst[], size_t rows, size_t cols);
+    void (*load_stride)(const uint16_t src[], size_t src_stride, ::GFT dst[], size_t rows, size_t cols);
+    void (*store_transposed)(const ::GFT src[], uint16_t dst[], size_t dst_stride, size_t rows, size_t cols);
+    void (*store_transposed_gft)(const ::GFT src[], ::GFT dst[], size_t dst_stride, size_t rows, size_t cols);
+    void (*store_stride)(const ::GFT src[], uint16_t dst[], size_t dst_stride, size_t rows, size_t cols);
+    void (*load_cols)(const uint16_t src[], size_t src_stride, const size_t col[], ::GFT dst[], size_t rows, size_t cols);
+    void (*store_cols)(const ::GFT src[], uint16_t dst[], size_t dst_stride, const size_t col[], size_t rows, size_t cols);
+
+    template<size_t W>
+    static constexpr layout_kernels of() {
+        return {
+            &vec::load_transposed<W, uint16_t>,
+            &vec::load_stride<W, uint16_t>,
+            &vec::store_transposed<W, uint16_t>,
+            &vec::store_transposed<W, ::GFT>,
+            &vec::store_stride<W, uint16_t>,
+            &vec::load_cols<W, uint16_t>,
+            &vec::store_cols<W, uint16_t>,
+        };
+    }
+};
+
+extern const layout_kernels layout_scalar;
+extern const layout_kernels layout_sse2;
+extern const layout_kernels layout_avx2;
+extern const layout_kernels layout_avx2x2;
+extern const layout_kernels layout_avx512f;
+
+/**
+ * Conversions through the kernels of `layout`, element types without one use the portable
+ * templates
+ */
+template<size_t W, typename Src>
+inline void load_transposed(layout_kernels const& layout, const Src src[], size_t src_stride, ::GFT dst[], size_t rows, size_t cols) {
+    if constexpr (std::is_same_v<Src, uint16_t>)
+        layout.load_transposed(&src[0], src_stride, &dst[0], rows, cols);
+    else
+        load_transposed<W>(&src[0], src_stride, &dst[0], rows, cols);
+}
+
+template<size_t W, typename Src>
+inline void load_stride(layout_kernels const& layout, const Src src[], size_t src_stride, ::GFT dst[], size_t rows, size_t cols) {
+    if constexpr (std::is_same_v<Src, uint16_t>)
+        layout.load_stride(&src[0], src_stride, &dst[0], rows, cols);
+    else
+        load_stride<W>(&src[0], src_stride, &dst[0], rows, cols);
+}
+
+template<size_t W, typename Dst>
+inline void store_transposed(layout_kernels const& layout, const ::GFT src[], Dst dst[], size_t dst_stride, size_t rows, size_t cols) {
+    if constexpr (std::is_same_v<Dst, uint16_t>)
+        layout.store_transposed(&src[0], &dst[0], dst_stride, rows, cols);
+    else if constexpr (std::is_same_v<Dst, ::GFT>)
+        layout.store_transposed_gft(&src[0], &dst[0], dst_stride, rows, cols);
+    else
+        store_transposed<W>(&src[0], &dst[0], dst_stride, rows, cols);
+}
+
+template<size_t W, typename Dst>
+inline void store_stride(layout_kernels const& layout, const ::GFT src[], Dst dst[], size_t dst_stride, size_t rows, size_t cols) {
+    if constexpr (std::is_same_v<Dst, uint16_t>)
+        layout.store_stride(&src[0], &dst[0], dst_stride, rows, cols);
+    else
+        store_stride<W>(&src[0], &dst[0], dst_stride, rows, cols);
+}
+
+template<size_t W, typename Src>
+inline void load_cols(layout_kernels const& layout, const Src src[], size_t src_stride, const size_t col[], ::GFT dst[], size_t rows, size_t cols) {
+    if constexpr (std::is_same_v<Src, uint16_t>)
+        layout.load_cols(&src[0], src_stride, &col[0], &dst[0], rows, cols);
+    else
+        load_cols<W>(&src[0], src_stride, &col[0], &dst[0], rows, cols);
+}
+
+template<size_t W, typename Dst>
+inline void store_cols(layout_kernels const& layout, const ::GFT src[], Dst dst[], size_t dst_stride, const size_t col[], size_t rows, size_t cols) {
+    if constexpr (std::is_same_v<Dst, uint16_t>)
+        layout.store_cols(&src[0], &dst[0], dst_stride, &col[0], rows, cols);
+    else
+        store_cols<W>(&src[0], &dst[0], dst_stride, &col[0], rows, cols);
+}
+
 }
 
 
@@ -18,16 +18,31 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <cstdlib>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
 #include <pybind11/pybind11.h>
 
 
 namespace detail {
 
 /**
- * Adaptor to automatically request buffer_info and cast pointer to data
+ * Adaptor to automatically request buffer_info and cast pointer to data.
+ * With `strict`, read-only objects such as `bytes` are rejected with BufferError
  */
-template<typename T, bool writeable>
+template<typename T, bool writeable, bool strict = false>
 class buffer_adaptor {
 public:
     pybind11::buffer buffer;
@@ -37,7 +52,7 @@ public:
 
     inline buffer_adaptor(const pybind11::buffer& o):
         buffer(std::move(o)),
-        info(buffer.request(false)),
+        info(buffer.request(strict)),
         size(size_t(info.size) / sizeof(T)),
         data(reinterpret_cast<T *>(info.ptr))
     {
@@ -60,6 +75,8 @@ template<typename T>
 using buffer_ro = detail::buffer_adaptor<const T, false>;
 template<typename T>
 using buffer_rw = detail::buffer_adaptor<T, true>;
+template<typename T>
+using buffer_out = detail::buffer_adaptor<T, true, true>;
 
 
 namespace detail {
@@ -73,6 +90,9 @@ struct cast_arg<T, buffer_ro<U>> { using type = pybind11::buffer&&; };
 template<typename T, typename U>
 struct cast_arg<T, buffer_rw<U>> { using type = pybind11::buffer&&; };
 
+template<typename T, typename U>
+struct cast_arg<T, buffer_out<U>> { using type = pybind11::buffer&&; };
+
 template<typename T>
 using cast_arg_t = typename cast_arg<T>::type;
 
@@ -111,3 +131,322 @@ std::unique_ptr<T[], decltype(&std::free)> new_aligned(size_t count, size_t alig
     if (!raw_ptr) throw std::bad_alloc();
     return std::unique_ptr<T[], decltype(&std::free)>(raw_ptr, &std::free);
 }
+
+
+/**
+ * Scratch memory reused across calls, handed out as a stack: a buffer is released when its
+ * handle goes out of scope, in reverse order of allocation. Calls needing more than the
+ * current block get extra blocks, merged into one block of the peak size once everything is
+ * released, so repeated calls with the same geometry neither allocate nor fault in new pages.
+ */
+class workspace {
+    struct block {
+        std::unique_ptr<std::byte[], decltype(&std::free)> data;
+        size_t begin;  // offset of data[0] in the stack
+        size_t size;
+    };
+
+    std::vector<block> blocks;
+    size_t used = 0;
+    size_t peak = 0;
+    size_t max_size;
+    std::atomic<bool> busy = false;
+
+    static inline thread_local workspace *_current = nullptr;
+
+    inline void _add_block(size_t begin, size_t size) {
+        size = std::max(size, max_alignment);
+        blocks.push_back({new_aligned<std::byte>(size, max_alignment), begin, size});
+    }
+
+    inline void _release(size_t top) {
+        assert(top <= used);  // released out of order
+        used = top;
+        while (blocks.size() > 1 && blocks.back().begin >= used)
+            blocks.pop_back();
+
+        if (used == 0 && peak > size()) {
+            blocks.clear();
+            if (peak <= max_size)
+                _add_block(0, peak);
+            else
+                peak = 0;
+        }
+    }
+
+public:
+    static constexpr size_t max_alignment = 64;
+
+    // peak size kept by the thread-local workspaces, larger calls allocate every time
+    static constexpr size_t local_max_size = size_t(64) << 20;
+
+    template<typename T>
+    class buffer {
+        workspace *ws;
+        size_t top;  // stack top before this buffer
+        T *ptr;
+
+        friend class workspace;
+        inline buffer(workspace *ws, size_t top, T *ptr): ws(ws), top(top), ptr(ptr) { }
+
+    public:
+        inline buffer(buffer&& other) noexcept: ws(std::exchange(other.ws, nullptr)), top(other.top), ptr(other.ptr) { }
+        buffer& operator=(buffer&&) = delete;
+
+        inline ~buffer() {
+            if (ws)
+                ws->_release(top);
+        }
+
+        inline T& operator[](size_t idx) const {
+            return ptr[idx];
+        }
+    };
+
+    /**
+     * Makes `ws` the workspace of the calling thread while in scope, nullptr keeps the current one.
+     * A workspace serves one call at a time.
+     */
+    class use {
+        workspace *ws;
+        workspace *prev;
+
+    public:
+        inline explicit use(workspace *ws): ws(ws), prev(_current) {
+            if (!ws)
+                return;
+            if (ws->busy.exchange(true))
+                throw std::runtime_error("Workspace already in use by another call");
+            _current = ws;
+        }
+
+        use(use const&) = delete;
+
+        inline ~use() {
+            if (ws) {
+                _current = prev;
+                ws->busy = false;
+            }
+        }
+    };
+
+    inline explicit workspace(size_t reserve = 0, size_t max_size = SIZE_MAX):
+        peak(reserve),
+        max_size(max_size)
+    {
+        if (reserve > 0)
+            _add_block(0, reserve);
+    }
+
+    workspace(workspace const&) = delete;
+
+    /**
+     * Workspace of the calling thread: the one installed with `use`, or a thread-local one
+     */
+    static inline workspace& current() {
+        thread_local workspace local(0, local_max_size);
+        return _current ? *_current : local;
+    }
+
+    /**
+     * `count` elements aligned to `alignment` <= max_alignment, uninitialized
+     */
+    template<typename T>
+    inline buffer<T> alloc(size_t count, size_t alignment = alignof(T)) {
+        size_t top = used;
+        size_t begin = (used + alignment - 1) & ~(alignment - 1);
+        size_t end = begin + count * sizeof(T);
+
+        if (blocks.empty() || end > blocks.back().begin + blocks.back().size) {
+            // blocks start where a single block would have the same alignment
+            begin = (used + max_alignment - 1) & ~(max_alignment - 1);
+            end = begin + count * sizeof(T);
+            _add_block(begin, std::max(end - begin, size()));
+        }
+
+        used = end;
+        peak = std::max(peak, end);
+        auto& b = blocks.back();
+        return buffer<T>(this, top, reinterpret_cast<T *>(&b.data[begin - b.begin]));
+    }
+
+    /**
+     * Bytes reserved
+     */
+    inline size_t size() const {
+        size_t total = 0;
+        for (auto const& b : blocks)
+            total += b.size;
+        return total;
+    }
+};
+
+
+/**
+ * Codec-owned output storage reused across calls and handed to Python as memoryviews.
+ * Each calling thread gets its own bytearray, so encodes running concurrently with the
+ * GIL released never write to the same memory. Storage only grows; a replaced bytearray
+ * stays alive while views into it exist. Contents are overwritten by the next call from
+ * the same thread. The storage of threads that exited is released by the next call.
+ */
+class reusable_output {
+    struct thread_storage {
+        // expires when the thread exits
+        std::weak_ptr<const void> thread;
+        pybind11::bytearray buf;
+    };
+
+    // accessed only with the GIL held
+    std::map<std::thread::id, thread_storage> storage;
+
+    // destroyed at thread exit without touching Python objects, which need the GIL
+    static inline std::shared_ptr<const void> const& _thread_token() {
+        thread_local const std::shared_ptr<const void> token = std::make_shared<const char>();
+        return token;
+    }
+
+public:
+    reusable_output() = default;
+
+    // copies start without storage
+    reusable_output(reusable_output const&) : reusable_output() {}
+    reusable_output& operator=(reusable_output const&) { return *this; }
+
+    /**
+     * Writable memoryview of the first `size` bytes of this thread's storage and a pointer to them
+     */
+    inline std::pair<pybind11::object, char *> get(size_t size) {
+        // also drops entries of exited threads whose id was reused by this thread
+        std::erase_if(storage, [](auto const& entry) { return entry.second.thread.expired(); });
+
+        auto& entry = storage[std::this_thread::get_id()];
+        entry.thread = _thread_token();
+        auto& buf = entry.buf;
+        if (size_t(PyByteArray_Size(buf.ptr())) < size)
+            buf = pybind11::bytearray(nullptr, size);
+
+        pybind11::object view = pybind11::memoryview(buf)[pybind11::slice(0, ssize_t(size), 1)];
+        return {std::move(view), PyByteArray_AsString(buf.ptr())};
+    }
+};
+
+
+/**
+ * New bytearray of `size` bytes, or a view of `reuse` when given, and a pointer to its data
+ */
+inline std::pair<pybind11::object, char *> output_buffer(size_t size, reusable_output *reuse = nullptr) {
+    if (reuse)
+        return reuse->get(size);
+
+    auto output = pybind11::bytearray(nullptr, size);
+    auto data = PyByteArray_AsString(output.ptr());
+    return {std::move(output), data};
+}
+
+
+/**
+ * Process-wide cache of immutable objects, shared while any owner holds a reference.
+ * Entries are weak, except for the `Recent` most recently requested objects, which are
+ * also kept alive without owners: codecs created and destroyed one after the other
+ * with the same key reuse the object instead of rebuilding it.
+ */
+template<typename Key, typename T, size_t Recent = 0>
+class shared_cache {
+    std::mutex mutex;
+    std::map<Key, std::weak_ptr<const T>> entries;
+    // most recent first
+    std::vector<std::shared_ptr<const T>> recent;
+
+    inline void _touch(std::shared_ptr<const T> const& ptr) {
+        if constexpr (Recent > 0) {
+            auto it = std::find(recent.begin(), recent.end(), ptr);
+            if (it == recent.end()) {
+                if (recent.size() < Recent)
+                    recent.emplace_back();
+                it = recent.end() - 1;
+            }
+            std::move_backward(recent.begin(), it, it + 1);
+            recent.front() = ptr;
+        }
+    }
+
+public:
+    template<typename Make>
+    std::shared_ptr<const T> get(Key const& key, Make&& make) {
+        std::lock_guard lock(mutex);
+
+        auto it = entries.find(key);
+        if (it != entries.end()) {
+            if (auto ptr = it->second.lock()) {
+                _touch(ptr);
+                return ptr;
+            }
+        }
+
+        std::shared_ptr<const T> ptr = make();
+
+        _touch(ptr);
+        std::erase_if(entries, [](auto const& entry) { return entry.second.expired(); });
+        entries[key] = ptr;
+        return ptr;
+    }
+};
+
+
+/**
+ * Run f(i) for i in [0, count) on up to `threads` threads, the calling thread included.
+ * Workers are started per call, so it is safe to use after fork(), and are meant for
+ * tasks long enough to amortize that. The first exception thrown by f is rethrown.
+ */
+template<typename F>
+void parallel_for(size_t threads, size_t count, F&& f) {
+    threads = std::min(threads, count);
+    if (threads <= 1) {
+        for (size_t i = 0; i < count; ++i)
+            f(i);
+        return;
+    }
+
+    std::atomic<size_t> next = 0;
+    std::mutex error_mutex;
+    std::exception_ptr error;
+
+    auto work = [&] {
+        for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count;) {
+            try {
+                f(i);
+            } catch (...) {
+                std::lock_guard lock(error_mutex);
+                if (!error)
+                    error = std::current_exception();
+                next = count;
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    try {
+        for (size_t t = 1; t < threads; ++t)
+            workers.emplace_back(work);
+    } catch (std::system_error const&) {
+        // continue with the workers already started
+    }
+
+    work();
+    for (auto& worker : workers)
+        worker.join();
+
+    if (error)
+        std::rethrow_exception(error);
+}
+
+
+/**
+ * Thread count from a `threads` argument, 0 for one per hardware thread
+ */
+inline size_t resolve_threads(size_t threads) {
+    if (threads == 0)
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+    return threads;
+}
@@ -318,3 +318,39 @@ def setup_logger():
 @pytest.mark.usefixtures("setup_logger")
 class TestCircSingle:
     pass
+
+
+def test_repair_log_records():
+    # records logged while the GIL is released are emitted once repair() returns
+    class Records(logging.Handler):
+        def __init__(self):
+            super().__init__()
+            self.messages = []
+
+        def emit(self, record):
+            self.messages.append(record.getMessage())
+
+    rs = ffrs.CIRC16(100, 2, 100, 2)
+    buf = randbytes(rs.message_size)
+    ecc = rs.encode(buf)
+
+    buf_orig = bytearray(buf)
+    ecc_orig = bytearray(ecc)
+
+    BaseTestCIRC().corrupt_outer_rows(rs, buf, ecc, rs.outer_ecc_len)
+
+    logger = logging.getLogger("test_lib_circ16")
+    logger.setLevel(logging.DEBUG)
+    logger.propagate = False
+    handler = Records()
+    logger.addHandler(handler)
+    ffrs.set_logger(logger)
+    try:
+        rs.repair(buf, ecc)
+    finally:
+        ffrs.set_logger(None)
+        logger.removeHandler(handler)
+
+    assert buf == buf_orig
+    assert ecc == ecc_orig
+    assert any(msg.startswith("errors found: interleave:0") for msg in handler.messages)
@@ -201,4 +201,41 @@ class TestNTT:
                     assert res[start : start + ntt.ecc_size] == res_ref
             mod *= 2
 
+    @pytest.mark.parametrize("block_len", [2048, 4096])
+    def test_cache_blocked(self, ntt: ffrs.NTT, block_len):
+        ntt = ffrs.NTT(gf, block_len, ntt.ecc_len)
+        data = randbytes(ntt.ntt16_size)
+
+        default_budget = ffrs.NTT.cache_budget
+        try:
+            data_ntt = ntt.ntt16(data)
+            data_intt = ntt.intt16(data)
+            ffrs.NTT.cache_budget = 1024
+            assert ffrs.NTT.cache_budget == 1024
+            assert ntt.ntt16(data) == data_ntt
+            assert ntt.intt16(data) == data_intt
+            assert ntt.intt16(ntt.ntt16(data)) == data
+        finally:
+            ffrs.NTT.cache_budget = default_budget
+
     # TODO: mul, div, inv tests with polynomials of different degrees + simd
+
+
+@pytest.mark.parametrize("simd", ["", "16"])
+@pytest.mark.parametrize("n", [2**k for k in range(1, 17)])
+def test_ntt_residue_bounds(n, simd):
+    # constant maximal input: the j = 0 butterflies grow the fastest, so a missing
+    # reduction of the residue arithmetic overflows for large n
+    lanes = 16 if simd else 1
+    const = lambda size: bytearray(b"\xff\xff" * size * lanes)
+    impulse = lambda size, x: (x.to_bytes(2, "little") + bytearray(2 * (size - 1))) * lanes
+
+    if n >= 4:
+        ntt = ffrs.NTT(gf, n, 2)
+        assert getattr(ntt, f"ntt{simd}")(const(n)) == impulse(n, 65535 * n % 65537)
+        assert getattr(ntt, f"intt{simd}")(const(n)) == impulse(n, 65535)
+
+    if n <= 32768:
+        ntt = ffrs.NTT(gf, n * 2, n)
+        assert getattr(ntt, f"nttr{simd}")(const(n)) == impulse(n, 65535 * n % 65537)
+        assert getattr(ntt, f"inttr{simd}")(const(n)) == impulse(n, 65535)
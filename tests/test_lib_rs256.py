@@ -89,6 +89,18 @@ class TestRS:
 
         assert ecc == rem
 
+    def test_encode_into(self, rs):
+        msg_a = randbytes(rs.message_size * 2 + 1)
+        ecc = rs.encode(msg_a)
+
+        out = bytearray(len(ecc) + 1)
+        assert rs.encode_into(msg_a, out) == len(ecc)
+        assert out == ecc + bytes(1)
+        assert rs.encode(msg_a, reuse_output=True) == ecc
+
+        with pytest.raises(BufferError):
+            rs.encode_into(msg_a, bytes(len(ecc)))
+
     def test_encode_decode(self, rs):
         msg_a = randbytes(rs.message_size)
 
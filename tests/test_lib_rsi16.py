@@ -14,8 +14,11 @@
 #  See the License for the specific language governing permissions and
 #  limitations under the License.
 
+import concurrent.futures
 import pytest
 import random
+import threading
+import tracemalloc
 
 import ffrs
 import ffrs.reference as ref
@@ -160,6 +163,27 @@ class BaseTestRS:
         assert len(buf_enc) == len(buf_enc_blk) == rs.ecc_size * count
         assert buf_enc == buf_enc_blk
 
+    @pytest.mark.parametrize("interleave,count", [(3, 5), (16, 7), (33, 3), (100, 4)])
+    def test_encode_interleaved_blocks_multiple(self, rs: ffrs.RSi16, interleave, count):
+        rsi = ffrs.RSi16(
+            rs.block_len,
+            rs.ecc_len,
+            interleave=interleave,
+            primitive=rs.gf.primitive,
+            simd_x4=rs.simd_x4,
+            simd_x8=rs.simd_x8,
+            simd_x16=rs.simd_x16,
+        )
+
+        buf = randbytes(rsi.message_size * count)
+
+        buf_enc = [rsi.encode(buf[i * rsi.message_size : (i + 1) * rsi.message_size]) for i in range(count)]
+        buf_enc = b"".join(buf_enc)
+        buf_enc_blk = rsi.encode(buf)
+
+        assert len(buf_enc) == len(buf_enc_blk) == rsi.ecc_size * count
+        assert buf_enc == buf_enc_blk
+
     @pytest.mark.parametrize("interleave", list(range(2, 15)) + [32, 48, 100, 256])
     def test_encode_interleaved(self, rs: ffrs.RSi16, interleave):
         assert rs.interleave == 1
@@ -167,6 +191,7 @@ class BaseTestRS:
             rs.block_len,
             rs.ecc_len,
             interleave=interleave,
+            primitive=rs.gf.primitive,
             simd_x4=rs.simd_x4,
             simd_x8=rs.simd_x8,
             simd_x16=rs.simd_x16,
@@ -194,6 +219,7 @@ class BaseTestRS:
             rs.block_len,
             rs.ecc_len,
             interleave=interleave,
+            primitive=rs.gf.primitive,
             simd_x4=rs.simd_x4,
             simd_x8=rs.simd_x8,
             simd_x16=rs.simd_x16,
@@ -218,6 +244,75 @@ class BaseTestRS:
         assert ecc_err == ecc_orig
         assert res == ffrs.RepairStatus.RepairOk
 
+    @pytest.mark.parametrize("interleave", [4, 8, 16, 32, 33])
+    def test_repair_interleaved_unknown_mixed(self, rs: ffrs.RSi16, interleave):
+        assert rs.interleave == 1
+        rsi = ffrs.RSi16(
+            rs.block_len,
+            rs.ecc_len,
+            interleave=interleave,
+            primitive=rs.gf.primitive,
+            simd_x4=rs.simd_x4,
+            simd_x8=rs.simd_x8,
+            simd_x16=rs.simd_x16,
+        )
+
+        msg_orig = randbytes(rsi.message_size)
+        ecc_orig = rsi.encode(msg_orig)
+
+        msg_err = bytearray(msg_orig)
+        ecc_err = bytearray(ecc_orig)
+
+        # Different error count in each column
+        for col in range(interleave):
+            for row in random.sample(range(rsi.rs_block_len), random.randint(0, rsi.rs_ecc_len // 2)):
+                if row < rsi.rs_message_len:
+                    offset = 2 * rsi.message_offset(row, col)
+                    msg_err[offset] ^= random.randint(1, 255)
+                else:
+                    offset = 2 * rsi.ecc_offset(row - rsi.rs_message_len, col)
+                    ecc_err[offset] ^= random.randint(1, 255)
+
+        rsi.repair(msg_err, ecc_err)
+        assert msg_err == msg_orig
+        assert ecc_err == ecc_orig
+
+    @pytest.mark.parametrize("interleave", [16, 33])
+    def test_repair_interleaved_unknown_straggler(self, rs: ffrs.RSi16, interleave):
+        assert rs.interleave == 1
+        rsi = ffrs.RSi16(
+            rs.block_len,
+            rs.ecc_len,
+            interleave=interleave,
+            primitive=rs.gf.primitive,
+            simd_x4=rs.simd_x4,
+            simd_x8=rs.simd_x8,
+            simd_x16=rs.simd_x16,
+        )
+
+        msg_orig = randbytes(rsi.message_size)
+        ecc_orig = rsi.encode(msg_orig)
+
+        msg_err = bytearray(msg_orig)
+        ecc_err = bytearray(ecc_orig)
+
+        # One column at full capacity, few errors in the others
+        heavy = random.randrange(interleave)
+        for col in range(interleave):
+            n = rsi.rs_ecc_len // 2 if col == heavy else random.randint(0, min(2, rsi.rs_ecc_len // 2))
+            for row in random.sample(range(rsi.rs_block_len), n):
+                if row < rsi.rs_message_len:
+                    offset = 2 * rsi.message_offset(row, col)
+                    msg_err[offset] ^= random.randint(1, 255)
+                else:
+                    offset = 2 * rsi.ecc_offset(row - rsi.rs_message_len, col)
+                    ecc_err[offset] ^= random.randint(1, 255)
+
+        res = rsi.repair(msg_err, ecc_err)
+        assert msg_err == msg_orig
+        assert ecc_err == ecc_orig
+        assert res == ffrs.RepairStatus.RepairOk
+
     @pytest.mark.parametrize("interleave", list(range(1, 16)) + [32, 33, 48, 50])
     @pytest.mark.parametrize("grace", range(4))
     def test_repair_interleaved_unknown_aligned(self, rs: ffrs.RSi16, interleave, grace):
@@ -226,6 +321,7 @@ class BaseTestRS:
             rs.block_len,
             rs.ecc_len,
             interleave=interleave,
+            primitive=rs.gf.primitive,
             simd_x4=rs.simd_x4,
             simd_x8=rs.simd_x8,
             simd_x16=rs.simd_x16,
@@ -252,6 +348,7 @@ class BaseTestRS:
             rs.block_len,
             rs.ecc_len,
             interleave=interleave,
+            primitive=rs.gf.primitive,
             simd_x4=rs.simd_x4,
             simd_x8=rs.simd_x8,
             simd_x16=rs.simd_x16,
@@ -270,6 +367,68 @@ class BaseTestRS:
         assert msg_err == msg_orig
         assert ecc_err == ecc_orig
 
+    @pytest.mark.parametrize("interleave", [1, 4, 16, 33])
+    @pytest.mark.parametrize("erasures", [0.1, 0.25, 0.5, 0.75, 0.9])
+    def test_repair_interleaved_errata(self, rs: ffrs.RSi16, interleave, erasures):
+        assert rs.interleave == 1
+        rsi = ffrs.RSi16(
+            rs.block_len,
+            rs.ecc_len,
+            interleave=interleave,
+            primitive=rs.gf.primitive,
+            simd_x4=rs.simd_x4,
+            simd_x8=rs.simd_x8,
+            simd_x16=rs.simd_x16,
+        )
+
+        erasure_count = max(int(rsi.rs_ecc_len * erasures), 1)
+
+        msg_orig = randbytes(rsi.message_size)
+        ecc_orig = rsi.encode(msg_orig)
+
+        msg_err = bytearray(msg_orig)
+        ecc_err = bytearray(ecc_orig)
+
+        # known rows plus unknown errors in every column, 2 * errors + erasures <= ecc_len
+        rows = add_aligned_errors(rsi, msg_err, ecc_err, erasure_count)
+        add_unaligned_errors(rsi, msg_err, ecc_err, (rsi.rs_ecc_len - erasure_count) // 2)
+
+        assert msg_err != msg_orig or ecc_err != ecc_orig
+        res = rsi.repair(msg_err, ecc_err, rows, unknown_errors=True)
+        assert res == ffrs.RepairStatus.RepairOk
+        assert msg_err == msg_orig
+        assert ecc_err == ecc_orig
+
+    @pytest.mark.parametrize("interleave", [1, 4, 16, 33])
+    @pytest.mark.parametrize("erasures", [0.1, 0.5, 0.9, 1.0])
+    def test_repair_interleaved_errata_erasures_only(self, rs: ffrs.RSi16, interleave, erasures):
+        assert rs.interleave == 1
+        rsi = ffrs.RSi16(
+            rs.block_len,
+            rs.ecc_len,
+            interleave=interleave,
+            primitive=rs.gf.primitive,
+            simd_x4=rs.simd_x4,
+            simd_x8=rs.simd_x8,
+            simd_x16=rs.simd_x16,
+        )
+
+        erasure_count = max(int(rsi.rs_ecc_len * erasures), 1)
+
+        msg_orig = randbytes(rsi.message_size)
+        ecc_orig = rsi.encode(msg_orig)
+
+        msg_err = bytearray(msg_orig)
+        ecc_err = bytearray(ecc_orig)
+
+        # known rows only, every column is repaired from the same erasure plan
+        rows = add_aligned_errors(rsi, msg_err, ecc_err, erasure_count)
+
+        res = rsi.repair(msg_err, ecc_err, rows, unknown_errors=True)
+        assert res == ffrs.RepairStatus.RepairOk
+        assert msg_err == msg_orig
+        assert ecc_err == ecc_orig
+
     def test_sugiyama_no_errors(self, rs: ffrs.RSi16, subtests):
         locator, evaluator = rs._sugiyama(bytearray(rs.ecc_size))
         assert locator[0] == 0
@@ -442,6 +601,19 @@ class TestRSMult(BaseTestRS):
     pass
 
 
+@pytest.mark.parametrize(
+    "rs",
+    [
+        # transforms with runtime twiddles: non-default primitive
+        ffrs.RSi16(16, ecc_len=4, primitive=5),
+        ffrs.RSi16(256, ecc_len=32, primitive=5),
+        ffrs.RSi16(256, ecc_len=32, primitive=7, simd_x16=False, simd_x8=False, simd_x4=False),
+    ],
+)
+class TestRSPrimitive(BaseTestRS):
+    pass
+
+
 @pytest.mark.parametrize(
     "rs",
     [
@@ -513,3 +685,343 @@ class TestRSLarge:
 
         assert msg_err == msg_orig
         assert ecc_err == ecc_orig
+
+
+if ffrs.check_bounds:
+    # exhaustive over the power-of-2 configurations, the library checks the residue bounds
+    residue_bounds_configs = [(1 << b, 1 << e) for b in range(2, 17) for e in range(1, b)]
+else:
+    # smallest, middle and largest ecc_len of a few block lengths
+    residue_bounds_configs = sorted({(1 << b, 1 << e) for b in (2, 5, 8, 12, 16) for e in (1, b // 2, b - 1)})
+
+
+@pytest.mark.parametrize("block_len, ecc_len", residue_bounds_configs)
+class TestResidueBounds:
+    # maximal symbols drive the residue bounds of the encoder and syndrome transforms,
+    # an overflow shows up as errors (or throws, built with FFRS_CHECK_BOUNDS)
+    @pytest.mark.parametrize("pattern", [b"\xff\xff", b"\xff\xff\x00\x00", b"\x00\x00\xff\xff"])
+    def test_encode_repair(self, block_len, ecc_len, pattern):
+        rs = ffrs.RSi16(block_len, ecc_len=ecc_len, interleave=16)
+        msg_orig = (pattern * rs.message_size)[: rs.message_size]
+        ecc_orig = rs.encode(msg_orig)
+
+        msg = bytearray(msg_orig)
+        ecc = bytearray(ecc_orig)
+        # RepairOk: ecc symbols equal to 0x10000 are stored as 0
+        res = rs.repair(msg, ecc)
+        assert res in (ffrs.RepairStatus.NoErrors, ffrs.RepairStatus.NoErrorsZero, ffrs.RepairStatus.RepairOk)
+        assert msg == msg_orig
+        assert ecc == ecc_orig
+
+
+@pytest.mark.parametrize("block_len, ecc_len, erasures", [(1024, 64, 3), (1024, 64, 20), (4096, 256, 172)])
+@pytest.mark.parametrize("interleave", [1, 16])
+@pytest.mark.parametrize("simd", [{}, {"simd_x16": False}, {"simd_x16": False, "simd_x8": False}, {"simd_x16": False, "simd_x8": False, "simd_x4": False}])
+def test_repair_errata_capacity(block_len, ecc_len, erasures, interleave, simd):
+    # one unknown error past 2 * errors + erasures <= ecc_len must not be reported as repaired,
+    # the erasures always give the errata locator roots
+    random.seed(block_len + erasures)
+    rs = ffrs.RSi16(block_len, ecc_len=ecc_len, interleave=interleave, **simd)
+    msg_orig = randbytes(rs.message_size)
+    ecc_orig = rs.encode(msg_orig)
+
+    for errors, status in [((ecc_len - erasures) // 2, ffrs.RepairStatus.RepairOk), ((ecc_len - erasures) // 2 + 1, ffrs.RepairStatus.ErrorLocationFail)]:
+        msg = bytearray(msg_orig)
+        ecc = bytearray(ecc_orig)
+        rows = add_aligned_errors(rs, msg, ecc, erasures)
+        # unknown errors outside the erased rows
+        other_rows = sorted(set(range(rs.rs_block_len)) - set(rows))
+        for col in range(interleave):
+            for row in random.sample(other_rows, errors):
+                if row < rs.rs_message_len:
+                    offset = 2 * rs.message_offset(row, col)
+                    msg[offset] ^= random.randint(1, 255)
+                else:
+                    offset = 2 * rs.ecc_offset(row - rs.rs_message_len, col)
+                    ecc[offset] ^= random.randint(1, 255)
+
+        assert rs.repair(msg, ecc, rows, unknown_errors=True) == status
+        if status == ffrs.RepairStatus.RepairOk:
+            assert msg == msg_orig
+            assert ecc == ecc_orig
+
+
+@pytest.mark.parametrize(
+    "block_len, ecc_len, error_counts",
+    [
+        # below and above the crossover to evaluating at the error positions
+        (1024, 64, [1, 8, 25, 26, 40, 64]),
+        (4096, 256, [1, 34, 35, 256]),
+        # always evaluated, the block doesn't fill the transform
+        (16 * 13, 8, [1, 8]),
+    ],
+)
+def test_repair_ntt(block_len, ecc_len, error_counts):
+    random.seed(block_len)
+    rs = ffrs.RSi16(block_len, ecc_len=ecc_len)
+    msg_orig = randbytes(rs.message_size)
+    ecc_orig = rs.encode(msg_orig)
+
+    for n in error_counts:
+        msg = bytearray(msg_orig)
+        ecc = bytearray(ecc_orig)
+        rows = add_aligned_errors(rs, msg, ecc, n)
+
+        rs._repair_ntt(msg, ecc, rows)
+        assert msg == msg_orig
+        assert ecc == ecc_orig
+
+
+def test_shared_plan():
+    # codecs with the same configuration share their tables, which outlive any single codec
+    msg = randbytes(ffrs.RSi16(256, ecc_len=32, interleave=4).message_size)
+
+    rs1 = ffrs.RSi16(256, ecc_len=32, interleave=4)
+    rs2 = ffrs.RSi16(256, ecc_len=32, interleave=4, simd_x16=False)
+    rs3 = ffrs.RSi16(256, ecc_len=32, interleave=4, primitive=5)
+    assert rs2._plan_id == rs1._plan_id
+    assert rs3._plan_id != rs1._plan_id
+    assert ffrs.RSi16(256, ecc_len=32, interleave=16)._plan_id == rs1._plan_id
+    assert ffrs.RSi16(256, ecc_len=16, interleave=4)._plan_id != rs1._plan_id
+
+    ecc = rs1.encode(msg)
+    del rs1
+
+    assert rs2.encode(msg) == ecc
+    assert rs3.encode(msg) != ecc
+
+    msg_err = bytearray(msg)
+    ecc_err = bytearray(ecc)
+    add_aligned_errors(rs2, msg_err, ecc_err, 16)
+    assert rs2.repair(msg_err, ecc_err) == ffrs.RepairStatus.RepairOk
+    assert msg_err == msg
+    assert ecc_err == ecc
+
+
+def test_shared_plan_recent():
+    # the most recent plans outlive their codecs
+    plan_id = ffrs.RSi16(512, ecc_len=64)._plan_id
+    assert ffrs.RSi16(512, ecc_len=64)._plan_id == plan_id
+
+    # older plans without codecs are rebuilt
+    for ecc_len in [2, 4, 8, 16, 32]:
+        ffrs.RSi16(512, ecc_len=ecc_len)
+    assert ffrs.RSi16(512, ecc_len=64)._plan_id != plan_id
+
+
+def test_simd_isa():
+    isa = ffrs.simd_isa()
+    assert [name for name, _, _ in isa] == ["avx512f", "avx2x2", "avx2", "sse2", "scalar"]
+    assert [width for _, width, _ in isa] == [16, 16, 8, 4, 1]
+    assert isa[-1] == ("scalar", 1, True)
+
+    default = ffrs.get_simd_isa()
+    msg = randbytes(ffrs.RSi16(256, ecc_len=32, interleave=16).message_size)
+    ecc = ffrs.RSi16(256, ecc_len=32, interleave=16).encode(msg)
+
+    try:
+        for name, width, supported in isa:
+            if not supported:
+                with pytest.raises(ValueError):
+                    ffrs.set_simd_isa(name)
+                continue
+
+            ffrs.set_simd_isa(name)
+            assert ffrs.get_simd_isa() == name
+            rs = ffrs.RSi16(256, ecc_len=32, interleave=16)
+            assert (rs.simd_x16, rs.simd_x8, rs.simd_x4) == (width >= 16, width >= 8, width >= 4)
+            if width == 16:
+                assert rs.simd_x16_avx2 == (name == "avx2x2")
+            assert rs.encode(msg) == ecc
+
+            msg_err = bytearray(msg)
+            ecc_err = bytearray(ecc)
+            add_aligned_errors(rs, msg_err, ecc_err, 16)
+            assert rs.repair(msg_err, ecc_err) == ffrs.RepairStatus.RepairOk
+            assert msg_err == msg
+            assert ecc_err == ecc
+
+        with pytest.raises(ValueError):
+            ffrs.set_simd_isa("unknown")
+    finally:
+        ffrs.set_simd_isa(None)
+
+    assert ffrs.get_simd_isa() == default
+
+
+@pytest.mark.parametrize("interleave", [1, 16, 1024])
+def test_encode_threads(interleave):
+    rs = ffrs.RSi16(256, ecc_len=32, interleave=interleave)
+    assert rs.threads == 1
+    blocks = max(1, 2048 // interleave)
+    msg = randbytes(rs.message_size * blocks)
+    ecc = rs.encode(msg)
+
+    for threads in [2, 3, 0]:
+        assert rs.encode(msg, threads=threads) == ecc
+
+    rs4 = ffrs.RSi16(256, ecc_len=32, interleave=interleave, threads=4)
+    assert rs4.threads == 4
+    assert rs4.encode(msg) == ecc
+    assert rs4.encode(msg, threads=1) == ecc
+
+
+@pytest.mark.parametrize("block_len, ecc_len", [(32, 16), (256, 32), (4096, 256)])
+@pytest.mark.parametrize("interleave", [16, 40, 64])
+def test_encode_epi16(block_len, ecc_len, interleave):
+    try:
+        rs16 = ffrs.RSi16(block_len, ecc_len=ecc_len, interleave=interleave, simd_epi16=True)
+    except ValueError:
+        pytest.skip("16-bit lane encode not supported by this CPU")
+
+    rs = ffrs.RSi16(block_len, ecc_len=ecc_len, interleave=interleave)
+    assert rs.simd_epi16 == 0
+    assert rs16.simd_epi16 in (16, 32)
+
+    # 0xffff and 0 next to random symbols, ecc symbols equal to 0x10000 are stored as 0
+    msg = bytearray(randbytes(rs.message_size * 3))
+    msg[::6] = b"\xff" * len(msg[::6])
+    msg[1::6] = b"\xff" * len(msg[1::6])
+    msg[2::10] = bytes(len(msg[2::10]))
+    msg[3::10] = bytes(len(msg[3::10]))
+
+    ecc = rs.encode(msg)
+    assert rs16.encode(msg) == ecc
+    assert rs16.encode(msg, threads=3) == ecc
+
+
+def test_encode_repair_concurrent():
+    codecs = [ffrs.RSi16(256, ecc_len=32), ffrs.RSi16(256, ecc_len=32, interleave=64)]
+    msgs = [randbytes(rs.message_size * 64 // rs.interleave) for rs in codecs]
+    eccs = [rs.encode(msg) for rs, msg in zip(codecs, msgs)]
+
+    def encode_repair(i):
+        rs = codecs[i % len(codecs)]
+        msg = bytearray(msgs[i % len(codecs)])
+        ecc = rs.encode(msg)
+        assert ecc == eccs[i % len(codecs)]
+
+        msg = bytearray(msg[: rs.message_size])
+        ecc = bytearray(ecc[: rs.ecc_size])
+        add_aligned_errors(rs, msg, ecc, 8)
+        return rs.repair(msg, ecc), msg == msgs[i % len(codecs)][: rs.message_size]
+
+    with concurrent.futures.ThreadPoolExecutor(max_workers=4) as pool:
+        for status, repaired in pool.map(encode_repair, range(16)):
+            assert status == ffrs.RepairStatus.RepairOk
+            assert repaired
+
+
+def test_encode_reuse_output_concurrent():
+    rs = ffrs.RSi16(256, ecc_len=32, interleave=16)
+    msgs = [randbytes(rs.message_size * (i + 1)) for i in range(4)]
+    eccs = [rs.encode(msg) for msg in msgs]
+
+    def encode(i):
+        views = []
+        for _ in range(8):
+            ecc = rs.encode(msgs[i % len(msgs)], reuse_output=True, threads=2)
+            views.append(ecc == eccs[i % len(msgs)])
+        return all(views)
+
+    with concurrent.futures.ThreadPoolExecutor(max_workers=4) as pool:
+        assert all(pool.map(encode, range(16)))
+
+
+def test_encode_reuse_output_thread_exit():
+    # the storage of threads that exited is released by the next call
+    rs = ffrs.RSi16(256, ecc_len=32, interleave=1024)
+    msg = randbytes(rs.message_size)
+    ecc = rs.encode(msg)
+
+    def encode():
+        assert rs.encode(msg, reuse_output=True) == ecc
+
+    encode()
+    tracemalloc.start()
+    try:
+        for _ in range(16):
+            thread = threading.Thread(target=encode)
+            thread.start()
+            thread.join()
+        encode()
+        size, _peak = tracemalloc.get_traced_memory()
+    finally:
+        tracemalloc.stop()
+
+    # one thread's storage at most, the main thread's was allocated before
+    assert size < 2 * rs.ecc_size
+
+
+@pytest.mark.parametrize("interleave", [1, 16])
+def test_encode_into(interleave):
+    rs = ffrs.RSi16(256, ecc_len=32, interleave=interleave)
+    blocks = max(1, 256 // interleave)
+    msg = randbytes(rs.message_size * blocks)
+    ecc = rs.encode(msg)
+
+    out = ffrs.create_buffer(len(ecc))
+    assert rs.encode_into(msg, out) == len(ecc)
+    assert out[: len(ecc)] == ecc
+
+    out = bytearray(len(ecc) + 2)
+    assert rs.encode_into(msg, out, threads=2) == len(ecc)
+    assert out == ecc + bytes(2)
+
+    with pytest.raises(RuntimeError):
+        rs.encode_into(msg, bytearray(len(ecc) - 2))
+    with pytest.raises(BufferError):
+        rs.encode_into(msg, bytes(len(ecc)))
+
+    view = rs.encode(msg, reuse_output=True)
+    assert isinstance(view, memoryview)
+    assert view == ecc
+    # a larger output replaces the storage, earlier views stay valid
+    larger = rs.encode(msg * 2, reuse_output=True)
+    assert larger == rs.encode(msg * 2)
+    assert view == ecc
+
+
+@pytest.mark.parametrize("interleave", [1, 64])
+def test_encode_workspace_threads(interleave):
+    rs = ffrs.RSi16(256, ecc_len=32, interleave=interleave)
+    # enough symbols to split between two threads
+    msg = randbytes(rs.message_size * (2 * 65536 // (rs.message_size // 2) + 1))
+    ecc = rs.encode(msg)
+
+    ws = ffrs.Workspace()
+    assert rs.encode(msg, threads=2, workspace=ws) == ecc
+    size = ws.size
+
+    # scratch of both threads comes from the caller's workspace
+    ws_single = ffrs.Workspace()
+    assert rs.encode(msg, threads=1, workspace=ws_single) == ecc
+    assert size > ws_single.size > 0
+
+    for _ in range(3):
+        assert rs.encode(msg, threads=2, workspace=ws) == ecc
+        assert ws.size == size
+
+
+@pytest.mark.parametrize("interleave", [1, 64])
+def test_repair_workspace(interleave):
+    rs = ffrs.RSi16(256, ecc_len=32, interleave=interleave)
+    ws = ffrs.Workspace()
+    assert ws.size == 0
+
+    msg = randbytes(rs.message_size)
+    ecc = rs.encode(msg, workspace=ws)
+
+    for _ in range(3):
+        msg_err = bytearray(msg)
+        ecc_err = bytearray(ecc)
+        add_aligned_errors(rs, msg_err, ecc_err, 4)
+        assert rs.repair(msg_err, ecc_err, workspace=ws) == ffrs.RepairStatus.RepairOk
+        assert msg_err == msg
+        assert ecc_err == ecc
+
+    # sized by the first repair and kept
+    size = ws.size
+    assert size > 0
+    assert rs.repair(bytearray(msg), bytearray(ecc), workspace=ws) == ffrs.RepairStatus.NoErrors
+    assert ws.size == size